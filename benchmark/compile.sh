@@ -0,0 +1,109 @@
+#!/bin/sh
+# Copyright (C) strawberryhacker.
+#
+# Times the compiler on the synthetic programs from generate.c, and reports the throughput of every
+# phase in lines and tokens per second. Every phase is run a few times and the fastest run is kept.
+#
+#   compile.sh <build directory> [runs]
+#
+# The results are appended to benchmark/results/compile.csv along with the commit, outside of the
+# build directory such that they survive a clean. When the file holds results from an earlier 
+# commit, the change against the latest of them is printed.
+
+build=${1:?usage: compile.sh <build directory> [runs]}
+runs=${2:-5}
+
+luxury=$build/luxury
+generate=$build/benchmark/generate
+work=$build/benchmark
+results=$(dirname "$0")/results/compile.csv
+
+# The shapes and sizes must stay the same for the results to be comparable across commits.
+shapes="functions:20000 nesting:500 structs:1000 expressions:4000 globals:40000"
+phases="load parse link type generate"
+
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+    commit="$commit-dirty"
+fi
+
+mkdir -p "$work" "$(dirname "$results")"
+[ -f "$results" ] || echo "commit,shape,size,lines,tokens,phase,milliseconds" > "$results"
+
+# The commit to compare against is the latest one in the results which is not this one.
+baseline=$(awk -F, -v commit="$commit" 'NR > 1 && $1 != commit { last = $1 } END { print last }' "$results")
+
+printf "Commit %s" "$commit"
+[ -n "$baseline" ] && printf ", compared against %s" "$baseline"
+printf "\n"
+
+for entry in $shapes; do
+    shape=${entry%%:*}
+    size=${entry##*:}
+    source=$work/$shape.lux
+
+    counts=$("$generate" "$shape" "$size" "$source") || {
+        echo "Generating $shape failed"
+        exit 1
+    }
+
+    set -- $counts
+    lines=$1
+    tokens=$2
+
+    printf "\n%s (size %s, %s lines, %s tokens)\n" "$shape" "$size" "$lines" "$tokens"
+    printf "  %-10s %12s %16s %16s %10s\n" "Phase" "Time (ms)" "Lines/s" "Tokens/s" "Change"
+
+    run=0
+    : > "$work/$shape.times"
+    while [ $run -lt "$runs" ]; do
+        "$luxury" --quiet --trace "$work/$shape.json" "$source" "$work/$shape.s" > /dev/null || {
+            echo "Compiling $shape failed"
+            exit 1
+        }
+
+        # The trace holds one complete event per line, and the phases are on the main thread.
+        sed -n 's/.*"cat":"phase","name":"\([^"]*\)".*"dur":\([0-9.]*\).*/\1 \2/p' "$work/$shape.json" >> "$work/$shape.times"
+        run=$((run + 1))
+    done
+
+    for phase in $phases total; do
+        awk -v phase="$phase" -v phases="$phases" -v runs="$runs" '
+            BEGIN { split(phases, list, " "); for (i in list) wanted[list[i]] = 1 }
+
+            # Every run lists its phases in order, so the total is summed per run.
+            wanted[$1] {
+                count[$1]++
+                if (!($1 in best) || $2 < best[$1]) best[$1] = $2
+                run_total[int((count[$1] - 1))] += $2
+            }
+
+            END {
+                if (phase == "total") {
+                    for (i = 0; i < runs; i++) if (!found || run_total[i] < value) { value = run_total[i]; found = 1 }
+                }
+                else {
+                    value = best[phase]
+                }
+                printf "%.3f\n", value / 1000
+            }' "$work/$shape.times" > "$work/$shape.best"
+
+        milliseconds=$(cat "$work/$shape.best")
+        previous=$(awk -F, -v commit="$baseline" -v shape="$shape" -v phase="$phase" \
+            '$1 == commit && $2 == shape && $6 == phase { value = $7 } END { print value }' "$results")
+
+        awk -v phase="$phase" -v ms="$milliseconds" -v lines="$lines" -v tokens="$tokens" -v previous="$previous" '
+            BEGIN {
+                seconds = ms / 1000
+                change = "-"
+                if (previous != "" && previous > 0) change = sprintf("%+.1f%%", 100 * (ms - previous) / previous)
+
+                if (seconds > 0) printf "  %-10s %12.3f %16.0f %16.0f %10s\n", phase, ms, lines / seconds, tokens / seconds, change
+                else             printf "  %-10s %12.3f %16s %16s %10s\n", phase, ms, "-", "-", change
+            }'
+
+        echo "$commit,$shape,$size,$lines,$tokens,$phase,$milliseconds" >> "$results"
+    done
+
+    rm -f "$work/$shape.times" "$work/$shape.best" "$work/$shape.json" "$work/$shape.s"
+done
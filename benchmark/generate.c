@@ -0,0 +1,302 @@
+// Copyright (C) strawberryhacker.
+//
+// This file generates synthetic luxury programs for the compile benchmark. Every shape stresses a
+// different part of the compiler, and the size scales the amount of code. The output only depends
+// on the shape and the size, so the programs are the same across commits.
+//
+//   generate <shape> <size> <output file>
+//
+// The number of lines and tokens in the program is printed, such that the benchmark can report
+// the throughput of every phase.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+
+typedef unsigned int u32;
+typedef unsigned long u64;
+
+// Number of members in each struct of the struct shape.
+#define STRUCT_MEMBER_COUNT 16
+
+// Number of operators in each statement of the expression shape.
+#define EXPRESSION_LENGTH 64
+
+static char* text;
+static u64 text_size;
+static u64 text_capacity;
+
+static void emit(const char* format, ...) {
+    va_list arguments;
+
+    while (1) {
+        va_start(arguments, format);
+        int size = vsnprintf(text + text_size, text_capacity - text_size, format, arguments);
+        va_end(arguments);
+
+        if (text_size + size < text_capacity) {
+            text_size += size;
+            return;
+        }
+
+        text_capacity = (text_capacity) ? text_capacity * 2 : 1 << 16;
+        text = realloc(text, text_capacity);
+
+        if (text == 0) {
+            printf("Generate : realloc failed\n");
+            exit(1);
+        }
+    }
+}
+
+// Every program prints through this, so the generated functions are actually called.
+static void emit_runtime() {
+    emit("syscall_print : asm (text: * char, size : u64) {\n");
+    emit("    mov %%rsi, %%rdx\n");
+    emit("    mov $1, %%rax\n");
+    emit("    mov $1, %%rbx\n");
+    emit("    mov %%rdi, %%rsi\n");
+    emit("    mov $0, %%rdi\n");
+    emit("    syscall\n");
+    emit("    ret\n");
+    emit("}\n\n");
+
+    emit("print : func (text: * char) {\n");
+    emit("    size := 0;\n");
+    emit("    pointer := text;\n\n");
+    emit("    while @pointer {\n");
+    emit("        pointer = pointer + 1;\n");
+    emit("        size = size + 1;\n");
+    emit("    }\n\n");
+    emit("    syscall_print(text, size);\n");
+    emit("}\n\n");
+}
+
+// Many small functions with a few locals, a branch and a loop each. Every function calls the one
+// before it, so the typer has to resolve the calls across the whole program.
+static void generate_functions(u32 size) {
+    for (u32 i = 0; i < size; i++) {
+        emit("f%u : func (a : u64, b : u64) -> u64 {\n", i);
+        emit("    c := a + b * 3;\n");
+        emit("    d : u64 = c + a * 2;\n");
+        emit("    if d > 10 {\n");
+        emit("        d = d - 10;\n");
+        emit("    }\n");
+        emit("    while d > 100 {\n");
+        emit("        d = d - 100;\n");
+        emit("    }\n");
+
+        // The arguments stay small, so the loop only runs a few times.
+        if (i) {
+            emit("    return f%u(d, a) + 1;\n", i - 1);
+        }
+        else {
+            emit("    return d;\n");
+        }
+
+        emit("}\n\n");
+    }
+
+    emit("main : func () {\n");
+    emit("    x := f%u(1, 2);\n", size - 1);
+    emit("    print(\"functions\\n\");\n");
+    emit("}\n");
+}
+
+static void indent(u32 depth) {
+    emit("%*s", 4 * depth, "");
+}
+
+// One function nested as deep as the size, alternating between conditionals and loops.
+static void generate_nesting(u32 size) {
+    emit("main : func () {\n");
+    emit("    x := 0;\n");
+
+    for (u32 i = 0; i < size; i++) {
+        indent(i + 1);
+
+        if (i % 2) {
+            emit("for i%u in 0 .. 2 {\n", i);
+        }
+        else {
+            emit("if x < %u {\n", i + 1);
+        }
+
+        indent(i + 2);
+        emit("x = x + 1;\n");
+    }
+
+    for (u32 i = size; i > 0; i--) {
+        indent(i);
+        emit("}\n");
+    }
+
+    emit("    print(\"nesting\\n\");\n");
+    emit("}\n");
+}
+
+// Big structs where every struct embeds the one after it, and a function writing to members at
+// different depths. Every layout depends on a struct which is declared later in the file.
+static void generate_structs(u32 size) {
+    for (u32 i = 0; i < size; i++) {
+        emit("S%u :: struct {\n", i);
+
+        if (i < size - 1) {
+            emit("    inner : S%u;\n", i + 1);
+        }
+
+        for (u32 j = 0; j < STRUCT_MEMBER_COUNT; j++) {
+            emit("    m%u : %s;\n", j, (j % 2) ? "u32" : "u64");
+        }
+
+        emit("}\n\n");
+    }
+
+    emit("main : func () {\n");
+    emit("    s : S0;\n");
+
+    for (u32 i = 0; i < size; i++) {
+        emit("    s");
+
+        for (u32 j = 0; j < i % 8 && j < size - 1; j++) {
+            emit(".inner");
+        }
+
+        emit(".m%u = %u;\n", i % STRUCT_MEMBER_COUNT, i);
+    }
+
+    emit("    print(\"structs\\n\");\n");
+    emit("}\n");
+}
+
+// Long chains of binary operators, which stress the expression parser and the code generator.
+static void generate_expressions(u32 size) {
+    static const char* operators[] = { "+", "-", "*", "+" };
+
+    emit("main : func () {\n");
+    emit("    a := 1;\n");
+    emit("    b := 2;\n");
+
+    for (u32 i = 0; i < size; i++) {
+        emit("    a = b");
+
+        for (u32 j = 0; j < EXPRESSION_LENGTH; j++) {
+            emit(" %s %s", operators[(i + j) % 4], (j % 3) ? "a" : "(b - 1)");
+        }
+
+        emit(";\n");
+    }
+
+    emit("    print(\"expressions\\n\");\n");
+    emit("}\n");
+}
+
+// Many global variables which are all used from one function.
+static void generate_globals(u32 size) {
+    for (u32 i = 0; i < size; i++) {
+        emit("g%u : %s;\n", i, (i % 2) ? "u32" : "u64");
+    }
+
+    emit("\nmain : func () {\n");
+
+    for (u32 i = 0; i < size; i++) {
+        emit("    g%u = g%u + %u;\n", i, (i) ? i - 1 : 0, i);
+    }
+
+    emit("    print(\"globals\\n\");\n");
+    emit("}\n");
+}
+
+// Counts the tokens the same way the lexer splits them. This is only used for reporting, so the
+// generated programs just have to stay within what is handled here.
+static u64 count_tokens(const char* text, u64 size, u64* line_count) {
+    static const char* pairs[] = { "->", "::", ":=", "==", "!=", "<=", ">=", "..", 0 };
+
+    u64 count = 0;
+    u64 i = 0;
+    *line_count = 0;
+
+    while (i < size) {
+        char c = text[i];
+
+        if (c == '\n') {
+            (*line_count)++;
+            i++;
+        }
+        else if (isspace(c)) {
+            i++;
+        }
+        else if (isalnum(c) || c == '_' || c == '%' || c == '$') {
+            while (i < size && (isalnum(text[i]) || text[i] == '_' || text[i] == '%' || text[i] == '$')) {
+                i++;
+            }
+            count++;
+        }
+        else if (c == '"') {
+            i++;
+            while (i < size && text[i] != '"') {
+                i += (text[i] == '\\') ? 2 : 1;
+            }
+            i++;
+            count++;
+        }
+        else {
+            u32 length = 1;
+
+            for (u32 j = 0; pairs[j]; j++) {
+                if (i + 1 < size && text[i] == pairs[j][0] && text[i + 1] == pairs[j][1]) {
+                    length = 2;
+                }
+            }
+
+            i += length;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+int main(int argument_count, char** arguments) {
+    if (argument_count != 4) {
+        printf("Usage : generate <functions|nesting|structs|expressions|globals> <size> <output file>\n");
+        exit(1);
+    }
+
+    const char* shape = arguments[1];
+    u32 size = atoi(arguments[2]);
+
+    if (size == 0) {
+        printf("Generate : the size must be at least one\n");
+        exit(1);
+    }
+
+    emit_runtime();
+
+    if      (strcmp(shape, "functions")   == 0) generate_functions(size);
+    else if (strcmp(shape, "nesting")     == 0) generate_nesting(size);
+    else if (strcmp(shape, "structs")     == 0) generate_structs(size);
+    else if (strcmp(shape, "expressions") == 0) generate_expressions(size);
+    else if (strcmp(shape, "globals")     == 0) generate_globals(size);
+    else {
+        printf("Generate : unknown shape %s\n", shape);
+        exit(1);
+    }
+
+    FILE* file = fopen(arguments[3], "w");
+    if (file == 0) {
+        printf("Generate : could not open %s\n", arguments[3]);
+        exit(1);
+    }
+
+    fwrite(text, 1, text_size, file);
+    fclose(file);
+
+    u64 line_count;
+    u64 token_count = count_tokens(text, text_size, &line_count);
+
+    printf("%lu %lu\n", line_count, token_count);
+    free(text);
+}
@@ -0,0 +1,97 @@
+// Copyright (C) strawberryhacker.
+//
+// This file has the C versions of the kernels in benchmark/kernels.lux. It is compiled once for
+// every optimization level, with PREFIX set to tell the copies apart.
+
+#include <stdint.h>
+
+typedef uint64_t u64;
+typedef uint32_t u32;
+typedef uint8_t u8;
+
+#define JOIN(a, b) a ## b
+#define NAME(prefix, name) JOIN(prefix, name)
+#define KERNEL(name) NAME(PREFIX, name)
+
+struct Particle {
+    u64 x;
+    u64 y;
+    u64 vx;
+    u64 vy;
+    u32 mass;
+};
+
+u64 KERNEL(string_length)(const char* text) {
+    u64 size = 0;
+
+    while (*text) {
+        text++;
+        size++;
+    }
+
+    return size;
+}
+
+u64 KERNEL(checksum)(const u8* data, u64 size) {
+    u64 a = 1;
+    u64 b = 0;
+
+    for (u64 i = 0; i < size; i++) {
+        a = a + data[i];
+        b = b + a;
+    }
+
+    return b * 65536 + a;
+}
+
+void KERNEL(matrix_multiply)(const u64* a, const u64* b, u64* c, u64 n) {
+    for (u64 i = 0; i < n; i++) {
+        for (u64 j = 0; j < n; j++) {
+            u64 sum = 0;
+
+            for (u64 k = 0; k < n; k++) {
+                sum += a[i * n + k] * b[k * n + j];
+            }
+
+            c[i * n + j] = sum;
+        }
+    }
+}
+
+void KERNEL(sort)(u64* data, u64 count) {
+    for (u64 i = 1; i < count; i++) {
+        u64 key = data[i];
+        u64 j = i;
+
+        while (j > 0 && data[j - 1] > key) {
+            data[j] = data[j - 1];
+            j--;
+        }
+
+        data[j] = key;
+    }
+}
+
+u64 KERNEL(particles)(u64 count) {
+    struct Particle p = { .x = 0, .y = 0, .vx = 1, .vy = 7, .mass = 3 };
+
+    for (u64 i = 0; i < count; i++) {
+        p.x  = p.x + p.vx * p.mass;
+        p.y  = p.y + p.vy;
+        p.vx = p.vx + 1;
+
+        if (p.y > 1000) {
+            p.y = p.y - 1000;
+        }
+    }
+
+    return p.x + p.y;
+}
+
+u64 KERNEL(fibonacci)(u64 n) {
+    if (n < 2) {
+        return n;
+    }
+
+    return KERNEL(fibonacci)(n - 1) + KERNEL(fibonacci)(n - 2);
+}
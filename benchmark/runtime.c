@@ -0,0 +1,255 @@
+// Copyright (C) strawberryhacker.
+//
+// This file runs the kernels compiled by luxury against the same kernels compiled by gcc at -O0
+// and -O2. Every kernel is run a few times on the same input, the fastest run is kept, and the
+// results of all three are checked against each other.
+//
+//   runtime [results file] [commit]
+//
+// When a results file is given, one line per kernel and compiler is appended to it.
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+typedef uint64_t u64;
+typedef uint32_t u32;
+typedef uint8_t u8;
+
+// Number of times every kernel is run.
+#define RUN_COUNT 5
+
+#define STRING_SIZE   (16 << 20)
+#define CHECKSUM_SIZE (16 << 20)
+#define MATRIX_SIZE   200
+#define SORT_COUNT    10000
+#define PARTICLES     50000000
+#define FIBONACCI     32
+
+#define DECLARE_KERNELS(prefix)                                                     \
+    u64  prefix##string_length(const char* text);                                   \
+    u64  prefix##checksum(const u8* data, u64 size);                                \
+    void prefix##matrix_multiply(const u64* a, const u64* b, u64* c, u64 n);        \
+    void prefix##sort(u64* data, u64 count);                                        \
+    u64  prefix##particles(u64 count);                                              \
+    u64  prefix##fibonacci(u64 n);
+
+DECLARE_KERNELS(lux_)
+DECLARE_KERNELS(gcc_O0_)
+DECLARE_KERNELS(gcc_O2_)
+
+enum { COMPILER_LUXURY, COMPILER_GCC_O0, COMPILER_GCC_O2, COMPILER_COUNT };
+
+static const char* compiler_names[COMPILER_COUNT] = { "luxury", "gcc -O0", "gcc -O2" };
+
+// The inputs are shared by all the compilers. Kernels which write to their input get a fresh copy
+// before every run.
+static char* text;
+static u8* bytes;
+static u64* matrix_a;
+static u64* matrix_b;
+static u64* matrix_c;
+static u64* sort_input;
+static u64* sort_data;
+
+static u64 get_time() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (u64)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static u64 hash_words(const u64* data, u64 count) {
+    u64 hash = 14695981039346656037ull;
+
+    for (u64 i = 0; i < count; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static u64 run_string_length(u32 compiler) {
+    switch (compiler) {
+        case COMPILER_LUXURY  : return lux_string_length(text);
+        case COMPILER_GCC_O0  : return gcc_O0_string_length(text);
+        default               : return gcc_O2_string_length(text);
+    }
+}
+
+static u64 run_checksum(u32 compiler) {
+    switch (compiler) {
+        case COMPILER_LUXURY  : return lux_checksum(bytes, CHECKSUM_SIZE);
+        case COMPILER_GCC_O0  : return gcc_O0_checksum(bytes, CHECKSUM_SIZE);
+        default               : return gcc_O2_checksum(bytes, CHECKSUM_SIZE);
+    }
+}
+
+static u64 run_matrix_multiply(u32 compiler) {
+    switch (compiler) {
+        case COMPILER_LUXURY  : lux_matrix_multiply(matrix_a, matrix_b, matrix_c, MATRIX_SIZE);    break;
+        case COMPILER_GCC_O0  : gcc_O0_matrix_multiply(matrix_a, matrix_b, matrix_c, MATRIX_SIZE); break;
+        default               : gcc_O2_matrix_multiply(matrix_a, matrix_b, matrix_c, MATRIX_SIZE); break;
+    }
+
+    return hash_words(matrix_c, MATRIX_SIZE * MATRIX_SIZE);
+}
+
+static void prepare_sort() {
+    memcpy(sort_data, sort_input, SORT_COUNT * sizeof(u64));
+}
+
+static u64 run_sort(u32 compiler) {
+    switch (compiler) {
+        case COMPILER_LUXURY  : lux_sort(sort_data, SORT_COUNT);    break;
+        case COMPILER_GCC_O0  : gcc_O0_sort(sort_data, SORT_COUNT); break;
+        default               : gcc_O2_sort(sort_data, SORT_COUNT); break;
+    }
+
+    return hash_words(sort_data, SORT_COUNT);
+}
+
+static u64 run_particles(u32 compiler) {
+    switch (compiler) {
+        case COMPILER_LUXURY  : return lux_particles(PARTICLES);
+        case COMPILER_GCC_O0  : return gcc_O0_particles(PARTICLES);
+        default               : return gcc_O2_particles(PARTICLES);
+    }
+}
+
+static u64 run_fibonacci(u32 compiler) {
+    switch (compiler) {
+        case COMPILER_LUXURY  : return lux_fibonacci(FIBONACCI);
+        case COMPILER_GCC_O0  : return gcc_O0_fibonacci(FIBONACCI);
+        default               : return gcc_O2_fibonacci(FIBONACCI);
+    }
+}
+
+struct Kernel {
+    const char* name;
+    u64 (*run)(u32 compiler);
+
+    // Called before every run, if the kernel changes its input.
+    void (*prepare)();
+};
+
+static const struct Kernel kernels[] = {
+    { "string_length",   run_string_length,   0            },
+    { "checksum",        run_checksum,        0            },
+    { "matrix_multiply", run_matrix_multiply, 0            },
+    { "sort",            run_sort,            prepare_sort },
+    { "particles",       run_particles,       0            },
+    { "fibonacci",       run_fibonacci,       0            }
+};
+
+static void* allocate(u64 size) {
+    void* memory = malloc(size);
+    if (memory == 0) {
+        printf("Runtime : malloc failed\n");
+        exit(1);
+    }
+
+    return memory;
+}
+
+// The inputs come from a fixed seed, so every run and every commit sees the same data.
+static void create_inputs() {
+    u64 state = 0x2545f4914f6cdd1dull;
+
+    text  = allocate(STRING_SIZE + 1);
+    bytes = allocate(CHECKSUM_SIZE);
+
+    for (u64 i = 0; i < STRING_SIZE; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        text[i] = 'a' + (state >> 59);
+    }
+    text[STRING_SIZE] = 0;
+
+    for (u64 i = 0; i < CHECKSUM_SIZE; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        bytes[i] = state >> 56;
+    }
+
+    matrix_a = allocate(MATRIX_SIZE * MATRIX_SIZE * sizeof(u64));
+    matrix_b = allocate(MATRIX_SIZE * MATRIX_SIZE * sizeof(u64));
+    matrix_c = allocate(MATRIX_SIZE * MATRIX_SIZE * sizeof(u64));
+
+    for (u64 i = 0; i < MATRIX_SIZE * MATRIX_SIZE; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        matrix_a[i] = state >> 48;
+        matrix_b[i] = state >> 40;
+    }
+
+    // The luxury comparisons are signed, so the values to sort stay below the sign bit.
+    sort_input = allocate(SORT_COUNT * sizeof(u64));
+    sort_data  = allocate(SORT_COUNT * sizeof(u64));
+
+    for (u64 i = 0; i < SORT_COUNT; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        sort_input[i] = state >> 33;
+    }
+}
+
+int main(int argument_count, char** arguments) {
+    FILE* results = 0;
+    const char* commit = (argument_count > 2) ? arguments[2] : "unknown";
+
+    if (argument_count > 1) {
+        results = fopen(arguments[1], "a");
+        if (results == 0) {
+            printf("Runtime : could not open %s\n", arguments[1]);
+            exit(1);
+        }
+    }
+
+    create_inputs();
+
+    printf("%-16s %12s %12s %12s %10s %10s\n", "Kernel", "luxury (ms)", "-O0 (ms)", "-O2 (ms)", "vs -O0", "vs -O2");
+
+    bool failed = false;
+
+    for (u32 i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+        const struct Kernel* kernel = &kernels[i];
+        double best[COMPILER_COUNT];
+        u64 result[COMPILER_COUNT];
+
+        for (u32 compiler = 0; compiler < COMPILER_COUNT; compiler++) {
+            best[compiler] = 0;
+
+            for (u32 run = 0; run < RUN_COUNT; run++) {
+                if (kernel->prepare) {
+                    kernel->prepare();
+                }
+
+                u64 start = get_time();
+                result[compiler] = kernel->run(compiler);
+                double milliseconds = (get_time() - start) / 1000000.0;
+
+                if (run == 0 || milliseconds < best[compiler]) {
+                    best[compiler] = milliseconds;
+                }
+            }
+
+            if (results) {
+                fprintf(results, "%s,%s,%s,%.3f\n", commit, kernel->name, compiler_names[compiler], best[compiler]);
+            }
+        }
+
+        printf("%-16s %12.3f %12.3f %12.3f %9.2fx %9.2fx\n", kernel->name, best[COMPILER_LUXURY], best[COMPILER_GCC_O0], best[COMPILER_GCC_O2],
+            best[COMPILER_LUXURY] / best[COMPILER_GCC_O0], best[COMPILER_LUXURY] / best[COMPILER_GCC_O2]);
+
+        if (result[COMPILER_LUXURY] != result[COMPILER_GCC_O0] || result[COMPILER_LUXURY] != result[COMPILER_GCC_O2]) {
+            printf("  %s : luxury computed %lu, gcc computed %lu and %lu\n", kernel->name, result[COMPILER_LUXURY], result[COMPILER_GCC_O0], result[COMPILER_GCC_O2]);
+            failed = true;
+        }
+    }
+
+    if (results) {
+        fclose(results);
+    }
+
+    return failed;
+}
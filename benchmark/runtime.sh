@@ -0,0 +1,52 @@
+#!/bin/sh
+# Copyright (C) strawberryhacker.
+#
+# Builds the kernels in kernels.lux with luxury and the kernels in kernels.c with gcc at -O0 and
+# -O2, and runs them all from runtime.c.
+#
+#   runtime.sh <build directory>
+#
+# The results are appended to benchmark/results/runtime.csv along with the commit, outside of the
+# build directory such that they survive a clean. When the file holds results from an earlier 
+# commit, the luxury times are compared against the latest of them.
+
+build=${1:?usage: runtime.sh <build directory>}
+directory=$(dirname "$0")
+work=$build/benchmark
+results=$directory/results/runtime.csv
+cc=${CC:-gcc}
+
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+    commit="$commit-dirty"
+fi
+
+mkdir -p "$work" "$directory/results"
+[ -f "$results" ] || echo "commit,kernel,compiler,milliseconds" > "$results"
+
+baseline=$(awk -F, -v commit="$commit" 'NR > 1 && $1 != commit { last = $1 } END { print last }' "$results")
+
+"$build/luxury" --quiet "$directory/kernels.lux" "$work/kernels.s" > /dev/null || exit 1
+
+$cc -c -O0 -DPREFIX=gcc_O0_ -o "$work/kernels_O0.o" "$directory/kernels.c" || exit 1
+$cc -c -O2 -DPREFIX=gcc_O2_ -o "$work/kernels_O2.o" "$directory/kernels.c" || exit 1
+$cc -O2 -o "$work/runtime" "$directory/runtime.c" "$work/kernels.s" "$work/kernels_O0.o" "$work/kernels_O2.o" -Wl,-z,noexecstack || exit 1
+
+echo "Commit $commit"
+"$work/runtime" "$results" "$commit" || status=1
+
+if [ -n "$baseline" ]; then
+    printf "\nluxury compared against %s\n" "$baseline"
+
+    awk -F, -v commit="$commit" -v baseline="$baseline" '
+        $3 == "luxury" && $1 == baseline { before[$2] = $4 }
+        $3 == "luxury" && $1 == commit   { after[$2] = $4; if (!($2 in seen)) { order[count++] = $2; seen[$2] = 1 } }
+        END {
+            for (i = 0; i < count; i++) {
+                kernel = order[i]
+                if (before[kernel] > 0) printf "  %-16s %+8.1f%%\n", kernel, 100 * (after[kernel] - before[kernel]) / before[kernel]
+            }
+        }' "$results"
+fi
+
+exit ${status:-0}
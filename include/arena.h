@@ -0,0 +1,79 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <types.h>
+#include <typedef.h>
+
+// Every compiler phase draws its tree nodes from its own arena. Nodes created by one phase are
+// still referenced by the later phases (the typer links new nodes into the parsed tree, and the
+// generator reads all of them), so the arenas are only released once the output is written.
+enum ArenaKind {
+    ARENA_PARSE,
+    ARENA_TYPE,
+    ARENA_CODEGEN,
+    ARENA_KIND_COUNT
+};
+
+// What an allocation is used for. This is only used for the memory statistics.
+enum AllocationKind {
+    ALLOCATION_TOKEN,
+    ALLOCATION_EXPRESSION,
+    ALLOCATION_STATEMENT,
+    ALLOCATION_DECLARATION,
+    ALLOCATION_TYPE,
+    ALLOCATION_SCOPE,
+    ALLOCATION_STRUCT_MEMBER,
+    ALLOCATION_STRUCT_SCOPE,
+    ALLOCATION_SYMBOL_TABLE,
+    ALLOCATION_TYPE_ITEM,
+    ALLOCATION_OTHER,
+    ALLOCATION_KIND_COUNT
+};
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    u64 size;
+};
+
+struct Arena {
+    ArenaBlock* blocks;
+
+    u8* cursor;
+    u8* end;
+
+    // Number of bytes handed out by this arena.
+    u64 allocated;
+
+    // Number of allocations and bytes of every kind.
+    u64 counts[ALLOCATION_KIND_COUNT];
+    u64 bytes[ALLOCATION_KIND_COUNT];
+};
+
+// Returns zeroed memory from the arena.
+void* arena_allocate(Arena* arena, u64 size);
+
+// Frees all blocks in one go. The arena can be used again afterwards.
+void arena_release(Arena* arena);
+
+// Selects the arena which phase_allocate will draw from. This must not be called while a parallel
+// loop is running.
+void arena_enter_phase(ArenaKind kind);
+
+// Returns the arena of the calling thread for the given phase.
+Arena* get_phase_arena(ArenaKind kind);
+
+// Returns zeroed memory from the arena of the current phase. This is safe to call from any thread.
+void* phase_allocate(AllocationKind kind, u64 size);
+
+// Releases the arenas of all threads. This must be called from the only thread which is left.
+void arena_release_all();
+
+// Samples the resident set size at every phase change. This has to be enabled before the first 
+// phase is entered.
+void arena_enable_statistics();
+
+// Prints the allocations by kind and by phase, and the resident set size of every phase. This must 
+// be called before the arenas are released, and not while a parallel loop is running.
+void arena_print_statistics();
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#include <types.h>
+#include <typedef.h>
+#include <emitter.h>
+#include <object.h>
+
+// Machine code of one function. Branches to local labels are kept out of the code bytes, since
+// their size is only known once all the labels are placed. The branches are relaxed and spliced
+// into the code when the function is finished.
+struct Branch {
+    // Position in the code bytes where the branch goes.
+    u32 position;
+    Mnemonic mnemonic;
+    Label label;
+    bool is_near;
+};
+
+// A label is placed in front of the code byte at the position, after the given number of
+// branches.
+struct LabelPosition {
+    u32 position;
+    u32 branch_count;
+};
+
+struct MachineCode {
+    u8* bytes;
+    u32 size;
+    u32 capacity;
+
+    Branch* branches;
+    u32 branch_count;
+    u32 branch_capacity;
+
+    // Local labels of every kind, indexed by the label number.
+    LabelPosition* labels[LABEL_KIND_COUNT];
+    u32 label_counts[LABEL_KIND_COUNT];
+
+    // Relocation offsets are positions in the code bytes until the function is finished.
+    Relocation* relocations;
+    u32 relocation_count;
+    u32 relocation_capacity;
+};
+
+// Encodes an instruction with the operands in AT&T order. Local labels may only be used by jumps,
+// and string labels must be given as symbols.
+void encode_instruction(MachineCode* code, Mnemonic mnemonic, Operand* operands, u32 operand_count);
+
+// Places a local label at the current position. The function end label is number zero.
+void encode_label(MachineCode* code, Label label);
+
+// Encodes the AT&T text of an assembly function. Only the instructions which the generator itself
+// emits are supported, plus syscall.
+void encode_assembly(MachineCode* code, String text, String function_name);
+
+// Relaxes the branches, and adds the function to the object fragment. The machine code is freed.
+void finish_machine_code(MachineCode* code, String function_name, OutputBuffer* fragment);
+
+// Decodes the escape sequences of a string literal like the .string directive does. The output
+// must hold at least as many bytes as the string, and the decoded size is returned.
+u32 decode_string(String string, u8* output);
+
+#endif
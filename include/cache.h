@@ -0,0 +1,39 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <types.h>
+#include <tree.h>
+#include <hash.h>
+#include <output.h>
+
+// Bump this whenever the generated code or the interface format changes.
+#define CACHE_VERSION "luxury-cache-2"
+
+// The cache is a plain directory of files named by the hash of everything that went into them. 
+// Until a directory is opened every lookup misses and nothing is stored.
+void cache_open(const char* directory, const char* options);
+bool cache_is_open();
+
+// Unmaps all the files loaded from the cache.
+void cache_close();
+
+// Hashes the source of the code unit, including the compiler version and the options.
+void cache_hash_source(CodeUnit* code_unit);
+
+// Hashes a freshly written interface of the code unit, and stores it in the cache.
+void cache_store_interface(CodeUnit* code_unit, OutputBuffer* interface);
+
+// Builds the global scope of every code unit whose interface is in the cache. These code units 
+// are marked as cached, and are not parsed.
+void cache_find_interfaces(CodeUnit** code_units, u32 count);
+
+// The output of a code unit depends on its own source and the interfaces of all the code units, 
+// or on all the sources if the program has inferred globals, so this must be called once all the
+// interfaces are known. Cached code units whose output is 
+// missing are turned back into regular code units, and have to be parsed.
+void cache_find_outputs(CodeUnit** code_units, u32 count);
+
+// Stores the output of every code unit which was generated in this run.
+void cache_store_outputs(Program* program);
+
+#endif
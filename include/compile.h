@@ -0,0 +1,39 @@
+#ifndef COMPILE_H
+#define COMPILE_H
+
+#include <types.h>
+#include <typedef.h>
+#include <tree.h>
+#include <thread_pool.h>
+
+struct Options {
+    u32 thread_count;
+    const char* cache_directory;
+    const char* trace_file;
+    const char* interface_file;
+    bool print_time;
+    bool print_memory;
+    bool print_tree;
+    bool reachable_only;
+
+    const char** input_files;
+    u32 input_count;
+    const char* output_file;
+};
+
+// Creates the code units for the input files, like load_code_units does. Code units which already
+// have a global scope are not parsed.
+typedef void (*LoadCodeUnits)(CodeUnit** code_units, const char** file_names, u32 count, ThreadPool* pool);
+
+void print_usage();
+
+bool is_option(const char* argument, const char* option);
+
+// Parses the command line without the program name. Returns false if it is not valid.
+bool parse_options(Options* options, int argument_count, char** arguments);
+
+// Compiles the input files into the output file. The code units are loaded with load_code_units 
+// unless another loader is given.
+void compile(Options* options, LoadCodeUnits load);
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include <types.h>
+#include <typedef.h>
+#include <output.h>
+
+// The generator describes every instruction with a mnemonic and a set of operands, and the 
+// emitter turns it into output. All the text is pre-encoded in tables with known sizes, so no 
+// format string is parsed for each instruction.
+
+// Registers in x86-64 encoding order.
+enum Register {
+    REGISTER_RAX,
+    REGISTER_RCX,
+    REGISTER_RDX,
+    REGISTER_RBX,
+    REGISTER_RSP,
+    REGISTER_RBP,
+    REGISTER_RSI,
+    REGISTER_RDI,
+    REGISTER_R8,
+    REGISTER_R9,
+    REGISTER_R10,
+    REGISTER_R11,
+    REGISTER_R12,
+    REGISTER_R13,
+    REGISTER_R14,
+    REGISTER_R15,
+    REGISTER_COUNT
+};
+
+enum Mnemonic {
+    MNEMONIC_PUSH,
+    MNEMONIC_POP,
+    MNEMONIC_MOV,
+    MNEMONIC_MOVSBQ,
+    MNEMONIC_MOVZBQ,
+    MNEMONIC_MOVSWQ,
+    MNEMONIC_MOVZWQ,
+    MNEMONIC_MOVSXD,
+    MNEMONIC_MOVZB,
+    MNEMONIC_LEA,
+    MNEMONIC_ADD,
+    MNEMONIC_SUB,
+    MNEMONIC_IMUL,
+    MNEMONIC_IDIV,
+    MNEMONIC_CDQ,
+    MNEMONIC_CMP,
+    MNEMONIC_SETE,
+    MNEMONIC_SETNE,
+    MNEMONIC_SETL,
+    MNEMONIC_SETLE,
+    MNEMONIC_SETG,
+    MNEMONIC_SETGE,
+    MNEMONIC_JMP,
+    MNEMONIC_JE,
+    MNEMONIC_CALL,
+    MNEMONIC_RET,
+    MNEMONIC_SYSCALL,
+    MNEMONIC_COUNT
+};
+
+enum OperandKind {
+    OPERAND_NONE,
+    OPERAND_REGISTER,
+    OPERAND_IMMEDIATE,
+    OPERAND_MEMORY,      // Displacement from a base register.
+    OPERAND_SYMBOL,      // Global symbol e.g. a function or a global variable.
+    OPERAND_LABEL,       // Compiler generated label.
+};
+
+enum LabelKind {
+    LABEL_LOOP_START,
+    LABEL_LOOP_END,
+    LABEL_IF_FALSE,
+    LABEL_IF_END,
+    LABEL_FUNCTION_END,  // Uses the function name instead of a number.
+    LABEL_STRING,
+    LABEL_KIND_COUNT
+};
+
+struct Label {
+    LabelKind kind;
+    u32 number;
+    String name;
+};
+
+struct Operand {
+    OperandKind kind;
+
+    // Register size in bytes.
+    u8 size;
+
+    // Register operand, or the base register of a memory operand.
+    Register reg;
+
+    // Immediate value or memory displacement.
+    s64 value;
+
+    String symbol;
+    Label label;
+};
+
+static inline Operand register_operand(Register reg, u32 size) {
+    return (Operand){ .kind = OPERAND_REGISTER, .reg = reg, .size = size };
+}
+
+static inline Operand immediate_operand(s64 value) {
+    return (Operand){ .kind = OPERAND_IMMEDIATE, .value = value };
+}
+
+static inline Operand memory_operand(Register base, s64 displacement) {
+    return (Operand){ .kind = OPERAND_MEMORY, .reg = base, .value = displacement };
+}
+
+static inline Operand symbol_operand(String symbol) {
+    return (Operand){ .kind = OPERAND_SYMBOL, .symbol = symbol };
+}
+
+static inline Operand label_operand(LabelKind kind, u32 number) {
+    return (Operand){ .kind = OPERAND_LABEL, .label = { .kind = kind, .number = number } };
+}
+
+static inline Operand function_end_operand(String name) {
+    return (Operand){ .kind = OPERAND_LABEL, .label = { .kind = LABEL_FUNCTION_END, .name = name } };
+}
+
+// The emitter either writes assembly text, or encodes the instructions into an object fragment.
+// Executables are linked from the same fragments as objects.
+enum OutputFormat {
+    OUTPUT_ASSEMBLY,
+    OUTPUT_OBJECT,
+    OUTPUT_EXECUTABLE,
+};
+
+// Every function is generated into its own emitter, so functions can be generated on separate
+// threads and still be written in a fixed order. Local labels include the function name, which 
+// keeps the label numbers of different functions apart.
+struct Emitter {
+    OutputBuffer text;
+    OutputBuffer data;
+
+    String function_name;
+
+    // Machine code of the function in object mode.
+    MachineCode* code;
+};
+
+// Selects the output format of all emitters. This must be called before anything is emitted.
+void emitter_set_format(OutputFormat format);
+
+void emitter_init(Emitter* emitter, String function_name);
+
+// Selects the emitter which the emit functions of the calling thread write to.
+void set_emitter(Emitter* emitter);
+
+// Moves the text of all the emitters in order, followed by all their data, to the output. In object
+// mode the functions are finished first, and the output is an object fragment.
+void emitter_collect(Emitter* emitters, u32 count, OutputBuffer* output);
+
+// Names as they are written in assembly text. Register names include the '%' prefix.
+String get_mnemonic_name(Mnemonic mnemonic);
+String get_register_name(Register reg, u32 size);
+
+// Operands are given in AT&T order, source first.
+void emit_instruction(Mnemonic mnemonic);
+void emit_instruction1(Mnemonic mnemonic, Operand operand);
+void emit_instruction2(Mnemonic mnemonic, Operand source, Operand destination);
+
+void emit_label(Label label);
+void emit_function_start(String name);
+void emit_assembly(String body);
+void emit_comment(String comment);
+void emit_code_unit_header(String file_name);
+
+// Data entries are collected in their own section, which is placed after the code when the output
+// is written.
+void emit_data_string(Label label, String string);
+void emit_data_zero(String name, u32 size);
+
+#endif
@@ -5,6 +5,6 @@
 #include <lexer.h>
 #include <stdarg.h>
 
-void error_token(Token* token, const char* message, ...);
+void error_token(u32 token, const char* message, ...);
 
 #endif
\ No newline at end of file
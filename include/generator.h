@@ -3,8 +3,15 @@
 
 #include <types.h>
 #include <tree.h>
+#include <thread_pool.h>
+#include <emitter.h>
 
-void generator_init(const char* output_file);
-void generate_program(Program* program);
+// Opens the output file. Assembly text is written for OUTPUT_ASSEMBLY, an ELF relocatable object
+// for OUTPUT_OBJECT, and a static ELF executable for OUTPUT_EXECUTABLE. The output file is only
+// created or replaced once generate_program has written all of it.
+void generator_init(const char* output_file, OutputFormat format);
+// Generates every code unit which is not cached, and writes the output of all the code units to
+// the output file.
+void generate_program(Program* program, ThreadPool* pool);
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <types.h>
+#include <typedef.h>
+
+// SHA-256. This is used for content addressing, where a collision would silently give the wrong
+// output, so a cryptographic hash is used instead of a fast one.
+#define HASH_SIZE 32
+
+struct Hash {
+    u32 state[8];
+    u64 length;
+
+    u8 block[64];
+    u32 block_size;
+};
+
+void hash_init(Hash* hash);
+void hash_update(Hash* hash, const void* data, u64 size);
+void hash_final(Hash* hash, u8 digest[HASH_SIZE]);
+
+// Formats the digest as lower-case hex. The buffer must hold 2 * HASH_SIZE + 1 chars.
+void hash_to_hex(u8 digest[HASH_SIZE], char* buffer);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef INTERFACE_H
+#define INTERFACE_H
+
+#include <types.h>
+#include <tree.h>
+#include <output.h>
+
+// An interface holds the global declarations of a code unit; the typedefs, the global variables 
+// and the function signatures. It is written straight after parsing, before the typer has 
+// resolved anything, so it only depends on the source of the code unit itself. Named types are 
+// stored by name, and are resolved by the typer wherever the interface is used.
+#define INTERFACE_MAGIC 0x3149584c  // "LXI1"
+
+#define INTERFACE_FILE_EXTENSION ".lxi"
+
+void write_interface(OutputBuffer* buffer, CodeUnit* code_unit);
+
+// Writes the interface file of a module, with the declarations of every code unit which is not 
+// imported itself. This is done after typing, such that inferred globals are written with the 
+// type they resolved to. Named types are still stored by name, so a program which uses a type 
+// from another module must import that module as well.
+void write_module_interface(const char* file_name, CodeUnit** code_units, u32 count);
+
+// Builds the global scope of the code unit from an interface. The names point into the data, so 
+// it must stay mapped for as long as the code unit is used. Returns false if the data is not a 
+// valid interface.
+bool read_interface(CodeUnit* code_unit, String data);
+
+#endif
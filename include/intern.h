@@ -0,0 +1,24 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <types.h>
+#include <typedef.h>
+
+// Symbol zero is never handed out, and is used to mark that something has no name.
+#define SYMBOL_NONE 0
+
+// Maps an identifier to a dense symbol ID. The same name always gives the same ID, so two names 
+// can be compared with a single integer compare. The interned text is not copied, so it must live 
+// for as long as the symbol is used.
+u32 intern_string(String* name);
+
+// Returns the name of an interned symbol.
+String* get_symbol_name(u32 symbol);
+
+u32 get_symbol_count();
+
+// Forgets every interned name, such that the texts they point into can be released. No symbol from
+// before may be used afterwards, and no other thread may be interning.
+void release_intern_table();
+
+#endif
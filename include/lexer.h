@@ -4,9 +4,14 @@
 #include <types.h>
 #include <string.h>
 
-#define TOKEN_PEEK_COUNT 10
-#define TOKEN_UNDO_COUNT 10
-#define TOKEN_BUFFER_SIZE (TOKEN_PEEK_COUNT + TOKEN_UNDO_COUNT + 2)
+// Tokens are referred to by a global index, such that a token from any file fits in a u32. Every
+// lexer claims whole pages of indices, and the page table maps an index back to its lexer.
+#define TOKEN_PAGE_BITS  14
+#define TOKEN_PAGE_SIZE  (1 << TOKEN_PAGE_BITS)
+#define TOKEN_PAGE_COUNT (1 << (32 - TOKEN_PAGE_BITS))
+
+// Token zero is never handed out, and is used to mark that something has no token.
+#define TOKEN_INDEX_NONE 0
 
 enum TokenKind {
     TOKEN_NONE,
@@ -55,6 +60,7 @@ enum TokenKind {
 };
 
 enum KeywordKind {
+    KEYWORD_NONE,
     KEYWORD_FUNC,
     KEYWORD_ASM,
     KEYWORD_U64,
@@ -78,64 +84,133 @@ enum KeywordKind {
     KEYWORD_KIND_COUNT
 };
 
-struct Token {
-    TokenKind kind;
-
-    Lexer* lexer;
-    String name;
-    u32    line;
-    u32    column;
-
-    u64 number;
-};
-
+// The lexer breaks the entire file into tokens up front. The tokens are stored as a structure of
+// arrays indexed by the position of the token in the file, which keeps the parser working on a 
+// few dense arrays instead of a buffer of big token structures.
 struct Lexer {
     String file;
     String file_name;
 
     char* cursor;
 
-    u32 line;
-    u32 column;
+    u8*  kinds;
+    u8*  keywords;
+    u32* offsets;    // Position of the token text in the file.
+    u32* sizes;
+    u32* values;     // Interned symbol of identifiers, and index into 'numbers' for numbers.
+    u64* numbers;
+
+    u32 token_count;
+    u32 number_count;
+    u32 token_capacity;
+    u32 number_capacity;
 
-    struct {
-        Token token;
-        bool is_valid;
-    } tokens[TOKEN_BUFFER_SIZE];
+    // Global index of the first token.
+    u32 first_token;
 
-    u32 current_index;
-    u32 buffer_index;
+    // Position of the parser.
+    u32 current;
+
+    // Offset of the first character of every line. This is only built when a location is needed, 
+    // see get_token_location.
+    u32* line_starts;
+    u32 line_count;
+
+    // Tokens from an interface have no source to point into.
+    bool is_interface;
 };
 
+extern Lexer* token_pages[TOKEN_PAGE_COUNT];
+
+// Lexes the entire file.
 Lexer* new_lexer(String* file, String* file_name);
 
+// Makes an empty lexer for names read from an interface. The names must all point into 'data'.
+Lexer* new_interface_lexer(String* data, String* file_name);
+
+// Adds a name to an interface lexer and returns the token.
+u32 add_interface_token(Lexer* lexer, String name);
+
+// Must be called when all the names are added to an interface lexer.
+void finish_interface_lexer(Lexer* lexer);
+
+// Hands all the token pages out again. No token from before may be used afterwards, and no other 
+// thread may be lexing.
+void release_token_pages();
+
+static inline Lexer* get_token_lexer(u32 token) {
+    return token_pages[token >> TOKEN_PAGE_BITS];
+}
+
+static inline u32 get_token_position(Lexer* lexer, u32 token) {
+    return token - lexer->first_token;
+}
+
+static inline TokenKind get_token_kind(u32 token) {
+    Lexer* lexer = get_token_lexer(token);
+    return lexer->kinds[get_token_position(lexer, token)];
+}
+
+static inline KeywordKind get_token_keyword(u32 token) {
+    Lexer* lexer = get_token_lexer(token);
+    return lexer->keywords[get_token_position(lexer, token)];
+}
+
+static inline u32 get_token_symbol(u32 token) {
+    Lexer* lexer = get_token_lexer(token);
+    return lexer->values[get_token_position(lexer, token)];
+}
+
+static inline u64 get_token_number(u32 token) {
+    Lexer* lexer = get_token_lexer(token);
+    return lexer->numbers[lexer->values[get_token_position(lexer, token)]];
+}
+
+static inline String get_token_name(u32 token) {
+    Lexer* lexer = get_token_lexer(token);
+    u32 position = get_token_position(lexer, token);
+
+    String name = { .text = lexer->file.text + lexer->offsets[position], .size = lexer->sizes[position] };
+    return name;
+}
+
+// Returns the line (starting at one) and the column (starting at zero) of the token. This is meant 
+// for diagnostics, as the first call for a file has to scan the entire file for line breaks.
+void get_token_location(u32 token, u32* line, u32* column);
+
 // Just returns the next token.
-Token* next_token(Lexer* lexer);
+u32 next_token(Lexer* lexer);
 
 // Returns the token 'count' ahead, but does not move the cursor.
-Token* peek_token(Lexer* lexer, u32 count);
+u32 peek_token(Lexer* lexer, u32 count);
 
 // Moves the cursor one step back.
-Token* undo_next_token(Lexer* lexer);
+u32 undo_next_token(Lexer* lexer);
 
 // Returns the next token, but does not move the cursor.
-Token* peek_next(Lexer* lexer);
+u32 peek_next(Lexer* lexer);
+
+// Moves the cursor to a token of this lexer.
+void seek_token(Lexer* lexer, u32 token);
 
 // Returns the current token.
-Token* current_token(Lexer* lexer);
+u32 current_token(Lexer* lexer);
 
 // Returns the current token, and moves the cursor to the next token.
-Token* consume_token(Lexer* lexer);
+u32 consume_token(Lexer* lexer);
 
 // Returns the next token if it matches the 'kind', otherwise it signals an error.
-Token* expect_token(Lexer* lexer, TokenKind kind);
+u32 expect_token(Lexer* lexer, TokenKind kind);
 
 // Returns next token if the current token matches the 'kind', otherwise it signals an error.
-Token* skip_token(Lexer* lexer, TokenKind kind);
+u32 skip_token(Lexer* lexer, TokenKind kind);
 
-bool is_keyword(Token* token, KeywordKind kind);
+// Identifiers are classified when they are lexed, so this is just a compare.
+static inline bool is_keyword(u32 token, KeywordKind kind) {
+    return get_token_keyword(token) == kind;
+}
 
 // Return the next toke if the current token is the given keyword, otherwise it signals an error.
-Token* skip_keyword(Lexer* lexer, KeywordKind kind);
+u32 skip_keyword(Lexer* lexer, KeywordKind kind);
 
 #endif
\ No newline at end of file
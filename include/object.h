@@ -0,0 +1,45 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <types.h>
+#include <typedef.h>
+#include <output.h>
+
+// In object mode every code unit is turned into a fragment instead of assembly text. A fragment is
+// a list of symbols with their contents and relocations, and it is what the cache stores for the
+// code unit. The fragments of all code units are laid out into one ELF64 relocatable object once
+// the whole program is generated, since only then are the section offsets known.
+
+enum ObjectSection {
+    OBJECT_TEXT,
+    OBJECT_DATA,
+    OBJECT_BSS,
+    OBJECT_SECTION_COUNT
+};
+
+enum RelocationKind {
+    RELOCATION_PC32,     // 32-bit PC relative address of the symbol.
+    RELOCATION_PLT32,    // 32-bit PC relative address of the symbol, or of its PLT entry.
+};
+
+struct Relocation {
+    // Offset of the 32-bit field from the start of the symbol.
+    u32 offset;
+    RelocationKind kind;
+    s32 addend;
+    String symbol;
+};
+
+// Adds a symbol to the fragment. All the data is copied, so nothing has to outlive the call. BSS
+// symbols have no data, only a size.
+void write_object_symbol(OutputBuffer* fragment, ObjectSection section, bool is_global, String name, const u8* data, u32 size, Relocation* relocations, u32 relocation_count);
+
+// Writes the fragments back to back as one relocatable object. Symbols which are referenced but
+// not defined are left for the linker.
+void write_object_file(int fd, OutputBuffer** fragments, u32 count);
+
+// Links the fragments and the runtime into a static executable. Every referenced symbol must be 
+// defined by the program, since no libraries are linked in.
+void write_executable_file(int fd, OutputBuffer** fragments, u32 count);
+
+#endif
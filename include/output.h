@@ -0,0 +1,42 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <types.h>
+#include <typedef.h>
+
+// Output is collected in a list of blocks. A full block is never copied, a new block is just 
+// linked in after it. All the blocks are handed to writev when the output is done.
+//
+// The code generator keeps one buffer per function, and most functions are small, so the first 
+// block is small and every new block doubles in size up to the maximum.
+#define OUTPUT_FIRST_BLOCK_SIZE (1024)
+#define OUTPUT_MAX_BLOCK_SIZE   (64 * 1024)
+
+struct OutputBlock {
+    OutputBlock* next;
+    u32 size;
+    u32 capacity;
+    char data[];
+};
+
+struct OutputBuffer {
+    OutputBlock* first;
+    OutputBlock* last;
+    u32 block_count;
+
+    // Total number of bytes in all blocks.
+    u64 size;
+};
+
+void output_init(OutputBuffer* buffer);
+void output_add(OutputBuffer* buffer, const char* data, u32 size);
+
+// Moves all the blocks of the source buffer to the end of the destination buffer. Nothing is 
+// copied, and the source buffer is left empty.
+void output_append(OutputBuffer* destination, OutputBuffer* source);
+
+// Writes the buffers back to back to the file descriptor.
+void output_write(int fd, OutputBuffer** buffers, u32 count);
+void output_release(OutputBuffer* buffer);
+
+#endif
@@ -4,17 +4,42 @@
 #include <types.h>
 #include <tree.h>
 #include <lexer.h>
+#include <thread_pool.h>
 
 struct Parser {
     Lexer* lexer;
 
     Scope* current_scope;
     StructScope* current_struct_scope;
+
+    // Children of the calls and compound statements being parsed. A list is collected on top of 
+    // the stack, and moved into the arena as an array once it is complete.
+    void** children;
+    u32 child_count;
+    u32 child_capacity;
 };
 
-Program* parser_program(Parser* parser);
 Parser* new_parser(Lexer* lexer);
 
+// Files with the interface file extension are imported modules, see interface.h.
+bool is_interface_file(const char* file_name);
+
+// Creates a code unit for every file, and loads and hashes the sources on the thread pool.
+void load_code_units(CodeUnit** code_units, const char** file_names, u32 count, ThreadPool* pool);
+
+// Lexes and parses every code unit which does not have a global scope yet on the thread pool.
+void parse_code_units(CodeUnit** code_units, u32 count, ThreadPool* pool);
+
+// Makes the parser skim the bodies of the global functions instead of parsing them, or parse them
+// again.
+void parser_set_skimming(bool is_enabled);
+
+// Parses the skimmed bodies of the functions which are used, on the thread pool.
+void parse_function_bodies(Program* program, ThreadPool* pool);
+
+// Links the code units together into a program in the order they are given.
+Program* link_code_units(CodeUnit** code_units, u32 count);
+
 #endif
 
 
@@ -0,0 +1,11 @@
+#ifndef REACHABILITY_H
+#define REACHABILITY_H
+
+#include <types.h>
+#include <tree.h>
+
+// Marks every function which can not be reached from main as unused. If the program is a module, 
+// every function is exported, and nothing is marked.
+void mark_unused_functions(Program* program, bool is_module);
+
+#endif
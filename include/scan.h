@@ -0,0 +1,25 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <types.h>
+
+// Block scanners used by the lexer. Each function checks 16 (SSE2) or 32 (AVX2) bytes at a time 
+// and returns the number of bytes from 'start' that belong to the run. The scanners never read at
+// or past 'end', and they may stop early when less than a full block is left, so the caller must 
+// finish the run with its regular character loop. Without SIMD support they all return zero.
+
+// Run of ' ', '\t', '\r' and '\n'.
+u32 scan_whitespace(const char* start, const char* end);
+
+// Run of letters, digits and underscores.
+u32 scan_identifier(const char* start, const char* end);
+
+// Run of bytes which are none of 'a', 'b' and 'c'.
+u32 scan_until(const char* start, const char* end, char a, char b, char c);
+
+// Finds the line breaks in the given span, and returns the number of them. A "\r\n" pair counts as
+// one line break at the '\n', and a lone '\r' counts as a line break as well. The offset of every 
+// line break is written to 'breaks', unless it is null.
+u32 find_line_breaks(const char* start, u32 size, u32* breaks);
+
+#endif
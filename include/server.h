@@ -0,0 +1,13 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <types.h>
+
+// Runs the compile server on a Unix socket. This never returns.
+void run_server(const char* socket_path);
+
+// Sends the command line options to the compile server, prints what the compilation printed, and 
+// exits with the status of the compilation.
+void run_client(const char* socket_path, int argument_count, char** arguments);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <types.h>
+
+// Loads a source file for the lexer. The resulting string is always followed by a zero 
+// terminator, and the size includes the terminator. Regular files are memory mapped read-only, 
+// while pipes and the special file name "-" (stdin) are streamed into a heap buffer.
+void load_source_file(String* source, const char* file_name);
+
+// Reads a copy of a source file into a heap buffer, such that later writes to the file do not 
+// change the source. Returns false if the file can not be opened.
+bool load_source_copy(String* source, const char* file_name);
+
+// Unmaps or frees a source loaded with load_source_file or load_source_copy.
+void unload_source_file(String* source);
+
+#endif
@@ -6,4 +6,10 @@
 
 bool string_compare(String* a, String* b);
 
+// Checks if a zero terminated file name ends with the extension.
+bool has_extension(const char* file_name, const char* extension);
+
+// Wraps a zero terminated string. The text is not copied.
+String make_string(const char* text);
+
 #endif
@@ -0,0 +1,27 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <types.h>
+#include <typedef.h>
+
+// Hash table which maps a non-zero u32 key (usually an interned symbol) to a pointer. A zeroed 
+// table is a valid empty table, so it can be embedded directly into zero-allocated tree nodes. 
+// The table memory is taken from the current phase arena.
+struct SymbolTable {
+    SymbolEntry* entries;
+    u32 capacity;
+    u32 count;
+};
+
+struct SymbolEntry {
+    u32 key;
+    void* value;
+};
+
+// Returns zero if the key is not in the table.
+void* table_lookup(SymbolTable* table, u32 key);
+
+// Inserts or replaces the value for the given key.
+void table_insert(SymbolTable* table, u32 key, void* value);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <types.h>
+#include <typedef.h>
+#include <pthread.h>
+
+// A task is called once for every index in the range given to thread_pool_run.
+typedef void (*Task)(void* context, u32 index);
+
+// The thread pool runs one parallel loop at a time. The calling thread takes part in the loop, so
+// a pool with a thread count of one does not start any threads.
+struct ThreadPool {
+    pthread_t* threads;
+    u32 thread_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+
+    // The loop which is currently running.
+    Task task;
+    void* context;
+    u32 task_count;
+    u32 next_index;
+
+    // Bumped for every loop, so the workers can tell a new loop from a spurious wakeup.
+    u32 generation;
+    u32 busy_workers;
+    bool stop;
+};
+
+ThreadPool* new_thread_pool(u32 thread_count);
+void free_thread_pool(ThreadPool* pool);
+
+// Calls the task for all indices from zero up to the count, and returns when all calls are done. 
+// The calls are spread over the threads in no particular order.
+void thread_pool_run(ThreadPool* pool, Task task, void* context, u32 count);
+
+// Returns the index of the calling thread within its pool. The thread calling thread_pool_run is 
+// always zero. This can be used to pick per-thread state.
+u32 get_thread_index();
+
+u32 get_processor_count();
+
+// The most threads a pool can be asked for on the command line.
+#define MAX_THREAD_COUNT 256
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <types.h>
+#include <typedef.h>
+
+// The phases of the compiler, and the work items inside them, can be timed. An event is recorded
+// by taking the time before the work, and passing it to trace_event after the work:
+//
+//   u64 start = trace_time();
+//   ...
+//   trace_event("parse", file_name, start);
+//
+// Nothing is recorded until tracing is enabled, and both calls return right away in that case.
+void trace_enable();
+bool trace_is_enabled();
+
+// Returns a monotonic time stamp in nanoseconds, or zero if tracing is disabled.
+u64 trace_time();
+
+// Records an event which started at the given time and ends now. The category must be a string
+// constant and the name must outlive the trace. This is safe to call from any thread.
+void trace_event(const char* category, String name, u64 start);
+
+// Prints the time of every phase, and the slowest items in every other category.
+void trace_print_summary();
+
+// Writes all the events to the file in the Chrome trace event format. This can be opened in
+// chrome://tracing or Perfetto.
+void trace_write(const char* file_name);
+
+#endif
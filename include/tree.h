@@ -4,6 +4,9 @@
 #include <types.h>
 #include <lexer.h>
 #include <list.h>
+#include <table.h>
+#include <hash.h>
+#include <output.h>
 
 enum ExpressionKind {
     EXPRESSION_PRIMARY = 1,
@@ -67,43 +70,45 @@ enum DeclarationKind {
     DECLARATION_TYPE,
 };
 
+// The tree refers to tokens by their global index, see lexer.h. The name of an identifier and the 
+// text of a string are taken from the token, so they are not stored in the node.
 struct Primary {
     PrimaryKind kind;
-    Token* token;
+    u32 token;
 
     union {
         struct {
-            String name;
+            u32 symbol;
             Declaration* declaration;
         };
         u64 number;
-        String string;
     };
 };
 
 struct Unary {
     UnaryKind kind;
-    Token* operator;
+    u32 operator;
     Expression* operand;
 };
 
 struct Binary {
     BinaryKind kind;
-    Token* operator;
+    u32 operator;
     Expression* left;
     Expression* right;
 };
 
+// Children are stored as contiguous arrays, such that a walk over them does not chase list nodes.
 struct Call {
-    Token* token;
+    u32 token;
+    u32 argument_count;
     Expression* expression;
-
-    List arguments;   // Expressions.
+    Expression** arguments;
 };
 
 struct Dot {
-    Token* dot_token;
-    Token* member;
+    u32 dot_token;
+    u32 member;
     u32 offset;
     Expression* expression;
 };
@@ -119,16 +124,16 @@ struct Expression {
 
     ExpressionKind kind;
     Type* type;
-    ListNode list_node; // Do we need this?
 };
 
 struct Compound {
-    List statements;
+    Statement** statements;
+    u32 statement_count;
     Scope* scope;
 };
 
 struct Comment {
-    Token* token;
+    u32 token;
 };
 
 struct ReturnStatement {
@@ -159,7 +164,6 @@ struct Statement {
     };
 
     StatementKind kind;
-    ListNode list_node;
 };
 
 struct PointerType {
@@ -172,7 +176,7 @@ struct BasicType {
 };
 
 struct UnknownType {
-    Token* token;
+    u32 token;
 };
 
 struct StructScope {
@@ -197,8 +201,9 @@ struct StructMember {
 
     Type* type;
     String name;
+    u32 symbol;
 
-    Token* token;
+    u32 token;
 
     u32 offset;
 };
@@ -229,6 +234,19 @@ struct Function {
 
     Scope* function_scope;
     bool assembly_function;
+
+    // Tokens of the body, from the opening curly up to the token after the closing curly. Both are
+    // zero for functions read from an interface.
+    u32 body_start;
+    u32 body_end;
+
+    // Set when the parser skipped over the body. It is parsed later if the function is used, see 
+    // reachability.c.
+    bool is_skimmed;
+
+    // Set for functions which can not be reached from the entry points. They are neither typed 
+    // nor generated.
+    bool is_unused;
 };
 
 struct Declaration {
@@ -240,12 +258,16 @@ struct Declaration {
     bool is_global;
 
     DeclarationKind kind;
-    Token* name_token;
+    u32 name_token;
 
     // Delcaration mapping.
     String name;
+    u32 symbol;
     Type* type;
 
+    // Typer items waiting for the type of this declaration.
+    TypeItem* waiters;
+
     ListNode list_node;
 };
 
@@ -255,6 +277,17 @@ struct Scope {
     List functions;
     List types;
 
+    // Hash indexes over the lists above, keyed by the declaration symbol. The lists are kept for 
+    // iterating the declarations in source order.
+    SymbolTable variable_index;
+    SymbolTable function_index;
+    SymbolTable type_index;
+
+    // Declarations found in a parent scope are cached here for deeply nested scopes, so that 
+    // repeated lookups do not walk the entire scope chain. See lookup_in_scope in the typer.
+    SymbolTable lookup_cache;
+    u32 depth;
+
     ListNode list_node;
 
     // This is for iterating through all the scopes, and for recursivly looking 
@@ -267,11 +300,36 @@ struct CodeUnit {
     ListNode list_node;
     String file_name;
 
+    // The source text, which all the names and tokens in the code unit point into.
+    String source;
+
     Scope* global_scope;
+
+    // Content hashes used by the compilation cache, see cache.c.
+    u8 source_hash[HASH_SIZE];
+    u8 interface_hash[HASH_SIZE];
+    u8 output_key[HASH_SIZE];
+    bool has_interface;
+
+    // Set when the output is taken from the cache. The global scope is then built from the 
+    // interface, and the code unit has no syntax tree.
+    bool is_cached;
+    String cached_output;
+
+    // Set when the code unit is an imported module interface. It only has the declarations, and
+    // the code comes from the object file of the module.
+    bool is_imported;
+
+    // Generated assembly of the code unit.
+    OutputBuffer output;
 };
 
 struct Program {
     List code_units;
+
+    // Parent of the global scope of every code unit. It only holds the indexes, so that a global
+    // declared in one file is visible in all the other files.
+    Scope* global_scope;
 };
 
 Program* new_program();
@@ -295,6 +353,9 @@ StructMember* new_struct_member();
 StructScope* new_struct_scope();
 
 
+List* get_declaration_list(Scope* scope, DeclarationKind kind);
+SymbolTable* get_declaration_index(Scope* scope, DeclarationKind kind);
+
 bool is_deref(Expression* expression);
 bool is_variable(Expression* expression);
 bool is_inferred(Expression* expression);
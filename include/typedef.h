@@ -10,12 +10,20 @@ typedef enum StatementKind StatementKind;
 typedef enum TypeKind TypeKind;
 typedef enum DeclarationKind DeclarationKind;
 typedef enum KeywordKind KeywordKind;
+typedef enum ArenaKind ArenaKind;
+typedef enum AllocationKind AllocationKind;
+typedef enum Register Register;
+typedef enum Mnemonic Mnemonic;
+typedef enum OperandKind OperandKind;
+typedef enum LabelKind LabelKind;
+typedef enum OutputFormat OutputFormat;
+typedef enum ObjectSection ObjectSection;
+typedef enum RelocationKind RelocationKind;
 
 typedef struct List List;
 typedef struct List ListNode;
 typedef struct Parser Parser;
 typedef struct String String;
-typedef struct Token Token;
 typedef struct Lexer Lexer;
 typedef struct Expression Expression;
 typedef struct Binary Binary;
@@ -36,13 +44,29 @@ typedef struct Variable Variable;
 typedef struct UnknownType UnknownType;
 typedef struct ReturnStatement ReturnStatement;
 typedef struct Typer Typer;
+typedef struct TypeItem TypeItem;
 typedef struct Call Call;
 typedef struct Loop Loop;
 typedef struct Conditional Conditional;
-typedef struct Array Array;
+typedef struct OutputBlock OutputBlock;
+typedef struct OutputBuffer OutputBuffer;
+typedef struct ThreadPool ThreadPool;
+typedef struct Hash Hash;
 typedef struct StructMember StructMember;
 typedef struct StructType StructType;
 typedef struct StructScope StructScope;
 typedef struct Dot Dot;
+typedef struct Arena Arena;
+typedef struct ArenaBlock ArenaBlock;
+typedef struct SymbolTable SymbolTable;
+typedef struct SymbolEntry SymbolEntry;
+typedef struct Operand Operand;
+typedef struct Label Label;
+typedef struct Emitter Emitter;
+typedef struct Relocation Relocation;
+typedef struct Branch Branch;
+typedef struct LabelPosition LabelPosition;
+typedef struct MachineCode MachineCode;
+typedef struct Options Options;
 
 #endif
\ No newline at end of file
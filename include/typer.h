@@ -4,6 +4,7 @@
 #include <types.h>
 #include <tree.h>
 #include <typedef.h>
+#include <thread_pool.h>
 
 extern Type* type_u64;
 extern Type* type_u32;
@@ -15,15 +16,41 @@ extern Type* type_s16;
 extern Type* type_s8;
 extern Type* type_char;
 
+// A unit of typing work. This is either a declaration whose type must be resolved, or a top-level
+// statement in a function body. An item which can not be typed yet is parked on the declaration 
+// it is waiting for, and is put back on the worklist when that declaration gets its type.
+struct TypeItem {
+    TypeItem* next;
+    Scope* scope;
+
+    Declaration* declaration;
+    Statement* statement;
+
+    // The function the statement belongs to.
+    Declaration* function;
+};
+
 struct Typer {
     Scope* current_scope;  
 
     StructType* current_struct;
 
-    bool type_resolved;
+    // Set while typing an item if anything in it could not be typed, along with the first 
+    // declaration it was blocked on.
     bool unresolved_types;
+    Declaration* blocker;
+
+    TypeItem* worklist_first;
+    TypeItem* worklist_last;
+
+    u32 waiting_count;
+    u32 stuck_count;
+
+    // Receives the inferred declarations of the function bodies being typed.
+    OutputBuffer* log;
 };
 
-void type_program(Program* programs, Typer* typer);
+// Types the global declarations, and then the function bodies on the thread pool.
+void type_program(Program* program, ThreadPool* pool);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,325 @@
+// Copyright (C) strawberryhacker.
+//
+// This file implements a simple bump allocator. Memory is taken from big zeroed blocks, and is
+// never freed individually. Instead the entire arena is released in one go. This removes the
+// per-object malloc overhead (both time and headers) for the millions of small tree nodes in big
+// source files.
+
+#include <arena.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+// All allocations are aligned to this. This covers every node type in the tree.
+#define ARENA_ALIGNMENT 16
+
+// Size of each block including the block header. Allocations larger than this get a separate
+// block.
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+// Every thread allocates from its own set of arenas, so the parallel phases never contend on the
+// allocator. The sets are linked together, such that all of them can be released at the end.
+struct ArenaSet {
+    struct ArenaSet* next;
+    Arena arenas[ARENA_KIND_COUNT];
+};
+
+static struct ArenaSet* arena_sets;
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local struct ArenaSet* thread_arenas;
+
+// The phase is only changed by the main thread between the parallel loops.
+static ArenaKind current_phase = ARENA_PARSE;
+
+// The resident set size in kilobytes, sampled when leaving a phase. The peak is reset when a phase
+// is entered, so it only covers that phase.
+struct PhaseMemory {
+    u64 peak;
+    u64 end;
+    bool sampled;
+};
+
+static bool statistics_enabled;
+static bool phase_entered;
+static struct PhaseMemory phase_memory[ARENA_KIND_COUNT];
+
+static const char* phase_names[ARENA_KIND_COUNT] = {
+    [ARENA_PARSE]   = "parse",
+    [ARENA_TYPE]    = "type",
+    [ARENA_CODEGEN] = "codegen"
+};
+
+static const char* allocation_names[ALLOCATION_KIND_COUNT] = {
+    [ALLOCATION_TOKEN]         = "token",
+    [ALLOCATION_EXPRESSION]    = "expression",
+    [ALLOCATION_STATEMENT]     = "statement",
+    [ALLOCATION_DECLARATION]   = "declaration",
+    [ALLOCATION_TYPE]          = "type",
+    [ALLOCATION_SCOPE]         = "scope",
+    [ALLOCATION_STRUCT_MEMBER] = "struct member",
+    [ALLOCATION_STRUCT_SCOPE]  = "struct scope",
+    [ALLOCATION_SYMBOL_TABLE]  = "symbol table",
+    [ALLOCATION_TYPE_ITEM]     = "type item",
+    [ALLOCATION_OTHER]         = "other"
+};
+
+// The last phase which reads each kind. The generator works on resolved declarations and offsets,
+// so the symbol tables and the struct layouts are not needed once the typer is done. Everything
+// else is read until the output is written.
+static const ArenaKind last_use[ALLOCATION_KIND_COUNT] = {
+    [ALLOCATION_TOKEN]         = ARENA_CODEGEN,
+    [ALLOCATION_EXPRESSION]    = ARENA_CODEGEN,
+    [ALLOCATION_STATEMENT]     = ARENA_CODEGEN,
+    [ALLOCATION_DECLARATION]   = ARENA_CODEGEN,
+    [ALLOCATION_TYPE]          = ARENA_CODEGEN,
+    [ALLOCATION_SCOPE]         = ARENA_CODEGEN,
+    [ALLOCATION_STRUCT_MEMBER] = ARENA_TYPE,
+    [ALLOCATION_STRUCT_SCOPE]  = ARENA_TYPE,
+    [ALLOCATION_SYMBOL_TABLE]  = ARENA_TYPE,
+    [ALLOCATION_TYPE_ITEM]     = ARENA_TYPE,
+    [ALLOCATION_OTHER]         = ARENA_CODEGEN
+};
+
+static u64 align_size(u64 size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(u64)(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaBlock* new_arena_block(Arena* arena, u64 block_size) {
+    // Big calloc requests are served by fresh pages which are already zeroed, so this does not 
+    // touch the memory up front.
+    ArenaBlock* block = calloc(1, block_size);
+    if (block == 0) {
+        printf("Arena : calloc failed\n");
+        exit(1);
+    }
+
+    block->size = block_size;
+    block->next = arena->blocks;
+    arena->blocks = block;
+
+    return block;
+}
+
+void* arena_allocate(Arena* arena, u64 size) {
+    u64 header = align_size(sizeof(ArenaBlock));
+    size = align_size(size);
+
+    arena->allocated += size;
+
+    if (size + header > ARENA_BLOCK_SIZE) {
+        // Oversized allocations get a block of their own. The current block is kept, so the space
+        // left in it is not wasted.
+        ArenaBlock* block = new_arena_block(arena, size + header);
+        return (u8 *)block + header;
+    }
+
+    if (arena->cursor == 0 || (u64)(arena->end - arena->cursor) < size) {
+        ArenaBlock* block = new_arena_block(arena, ARENA_BLOCK_SIZE);
+
+        arena->cursor = (u8 *)block + header;
+        arena->end    = (u8 *)block + ARENA_BLOCK_SIZE;
+    }
+
+    void* memory = arena->cursor;
+    arena->cursor += size;
+
+    return memory;
+}
+
+void arena_release(Arena* arena) {
+    ArenaBlock* block = arena->blocks;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->blocks    = 0;
+    arena->cursor    = 0;
+    arena->end       = 0;
+    arena->allocated = 0;
+
+    for (u32 i = 0; i < ALLOCATION_KIND_COUNT; i++) {
+        arena->counts[i] = 0;
+        arena->bytes[i]  = 0;
+    }
+}
+
+// Returns the given field of /proc/self/status in kilobytes, or zero if it is not there.
+static u64 read_status_field(const char* format) {
+    FILE* file = fopen("/proc/self/status", "r");
+    if (file == 0) {
+        return 0;
+    }
+
+    char line[256];
+    u64 value = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, format, &value) == 1) {
+            break;
+        }
+    }
+
+    fclose(file);
+    return value;
+}
+
+static void sample_phase_memory(ArenaKind kind) {
+    phase_memory[kind].peak    = read_status_field("VmHWM: %lu kB");
+    phase_memory[kind].end     = read_status_field("VmRSS: %lu kB");
+    phase_memory[kind].sampled = true;
+}
+
+// Writing five to clear_refs resets the peak resident set size to the current size. On kernels 
+// without this the peak just covers all phases so far.
+static void reset_peak_memory() {
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (file) {
+        fputs("5", file);
+        fclose(file);
+    }
+}
+
+void arena_enter_phase(ArenaKind kind) {
+    if (statistics_enabled) {
+        if (phase_entered) {
+            sample_phase_memory(current_phase);
+        }
+
+        reset_peak_memory();
+        phase_entered = true;
+    }
+
+    current_phase = kind;
+}
+
+Arena* get_phase_arena(ArenaKind kind) {
+    if (thread_arenas == 0) {
+        thread_arenas = calloc(1, sizeof(struct ArenaSet));
+        if (thread_arenas == 0) {
+            printf("Arena : calloc failed\n");
+            exit(1);
+        }
+
+        pthread_mutex_lock(&arena_lock);
+        thread_arenas->next = arena_sets;
+        arena_sets = thread_arenas;
+        pthread_mutex_unlock(&arena_lock);
+    }
+
+    return &thread_arenas->arenas[kind];
+}
+
+void* phase_allocate(AllocationKind kind, u64 size) {
+    Arena* arena = get_phase_arena(current_phase);
+
+    arena->counts[kind]++;
+    arena->bytes[kind] += align_size(size);
+
+    return arena_allocate(arena, size);
+}
+
+void arena_release_all() {
+    pthread_mutex_lock(&arena_lock);
+
+    // The sets of the threads which have exited would otherwise pile up in the compile server.
+    struct ArenaSet* set = arena_sets;
+    while (set) {
+        struct ArenaSet* next = set->next;
+
+        for (u32 i = 0; i < ARENA_KIND_COUNT; i++) {
+            arena_release(&set->arenas[i]);
+        }
+
+        free(set);
+        set = next;
+    }
+
+    arena_sets    = 0;
+    thread_arenas = 0;
+
+    pthread_mutex_unlock(&arena_lock);
+}
+
+void arena_enable_statistics() {
+    statistics_enabled = true;
+}
+
+static double to_kilobytes(u64 bytes) {
+    return bytes / 1024.0;
+}
+
+void arena_print_statistics() {
+    // The last phase is still running.
+    if (phase_entered) {
+        sample_phase_memory(current_phase);
+    }
+
+    u64 counts[ARENA_KIND_COUNT][ALLOCATION_KIND_COUNT] = { 0 };
+    u64 bytes[ARENA_KIND_COUNT][ALLOCATION_KIND_COUNT]  = { 0 };
+    u64 reserved[ARENA_KIND_COUNT] = { 0 };
+
+    pthread_mutex_lock(&arena_lock);
+
+    for (struct ArenaSet* set = arena_sets; set; set = set->next) {
+        for (u32 phase = 0; phase < ARENA_KIND_COUNT; phase++) {
+            Arena* arena = &set->arenas[phase];
+
+            for (u32 kind = 0; kind < ALLOCATION_KIND_COUNT; kind++) {
+                counts[phase][kind] += arena->counts[kind];
+                bytes[phase][kind]  += arena->bytes[kind];
+            }
+
+            for (ArenaBlock* block = arena->blocks; block; block = block->next) {
+                reserved[phase] += block->size;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&arena_lock);
+
+    printf("\n%-16s %12s %14s %12s\n", "Kind", "Count", "Size (KB)", "Last used");
+
+    for (u32 kind = 0; kind < ALLOCATION_KIND_COUNT; kind++) {
+        u64 count = 0;
+        u64 size  = 0;
+
+        for (u32 phase = 0; phase < ARENA_KIND_COUNT; phase++) {
+            count += counts[phase][kind];
+            size  += bytes[phase][kind];
+        }
+
+        printf("%-16s %12lu %14.1f %12s\n", allocation_names[kind], count, to_kilobytes(size), phase_names[last_use[kind]]);
+    }
+
+    // Bytes are dead after a phase once no later phase reads their kind, no matter which phase 
+    // allocated them. The arenas still hold them until the end.
+    printf("\n%-10s %14s %14s %14s %14s %14s\n", "Phase", "Used (KB)", "Reserved (KB)", "Dead (KB)", "Peak RSS (KB)", "End RSS (KB)");
+
+    for (u32 phase = 0; phase < ARENA_KIND_COUNT; phase++) {
+        u64 used = 0;
+        u64 dead = 0;
+
+        for (u32 kind = 0; kind < ALLOCATION_KIND_COUNT; kind++) {
+            used += bytes[phase][kind];
+
+            if (last_use[kind] == phase) {
+                for (u32 i = 0; i < ARENA_KIND_COUNT; i++) {
+                    dead += bytes[i][kind];
+                }
+            }
+        }
+
+        printf("%-10s %14.1f %14.1f %14.1f", phase_names[phase], to_kilobytes(used), to_kilobytes(reserved[phase]), to_kilobytes(dead));
+
+        if (phase_memory[phase].sampled) {
+            printf(" %14lu %14lu\n", phase_memory[phase].peak, phase_memory[phase].end);
+        }
+        else {
+            printf(" %14s %14s\n", "-", "-");
+        }
+    }
+
+    printf("\n");
+}
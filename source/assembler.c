@@ -0,0 +1,822 @@
+// Copyright (C) strawberryhacker.
+//
+// This file encodes the instructions from the generator straight into x86-64 machine code. Only
+// the forms the generator uses are supported, with the same encodings as the GNU assembler picks
+// for them. Symbols are addressed relative to the instruction pointer, and calls go through PLT32
+// relocations, so the object links the same way as the assembled text.
+//
+// Jumps to local labels start out short (rel8), and are grown to near jumps (rel32) until every
+// displacement fits. A jump only ever grows, so this always settles.
+
+#include <assembler.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define REX   0x40
+#define REX_W 0x08
+#define REX_R 0x04
+#define REX_B 0x01
+
+// Label positions which are not placed yet.
+#define LABEL_NOT_PLACED UINT32_MAX
+
+static void* grow_array(void* array, u32* capacity, u32 count, u32 element_size) {
+    if (count < *capacity) {
+        return array;
+    }
+
+    *capacity = (*capacity) ? 2 * *capacity : 64;
+    array = realloc(array, (u64)*capacity * element_size);
+    if (array == 0) {
+        printf("Assembler : realloc failed\n");
+        exit(1);
+    }
+
+    return array;
+}
+
+static void add_byte(MachineCode* code, u8 byte) {
+    code->bytes = grow_array(code->bytes, &code->capacity, code->size, 1);
+    code->bytes[code->size++] = byte;
+}
+
+static void add_value(MachineCode* code, u64 value, u32 size) {
+    for (u32 i = 0; i < size; i++) {
+        add_byte(code, value >> (8 * i));
+    }
+}
+
+// Two byte opcodes are given with the 0x0f escape in the high byte.
+static void add_opcode(MachineCode* code, u32 opcode) {
+    if (opcode > 0xff) {
+        add_byte(code, opcode >> 8);
+    }
+
+    add_byte(code, opcode);
+}
+
+static void add_relocation(MachineCode* code, RelocationKind kind, String symbol, s32 addend) {
+    code->relocations = grow_array(code->relocations, &code->relocation_capacity, code->relocation_count, sizeof(Relocation));
+    code->relocations[code->relocation_count++] = (Relocation){ .offset = code->size, .kind = kind, .addend = addend, .symbol = symbol };
+    add_value(code, 0, 4);
+}
+
+static bool fits_s8(s64 value) {
+    return value >= INT8_MIN && value <= INT8_MAX;
+}
+
+static bool fits_s32(s64 value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+static void cannot_encode(Mnemonic mnemonic) {
+    String name = get_mnemonic_name(mnemonic);
+    printf("Assembler : %.*s does not take these operands\n", name.size, name.text);
+    exit(1);
+}
+
+static bool is_register(Operand* operand, u32 size) {
+    return operand->kind == OPERAND_REGISTER && (size == 0 || operand->size == size);
+}
+
+// Memory operands, and symbols which are addressed relative to the instruction pointer.
+static bool is_memory(Operand* operand) {
+    return operand->kind == OPERAND_MEMORY || operand->kind == OPERAND_SYMBOL;
+}
+
+// spl, bpl, sil and dil can only be encoded with a REX prefix. Without it they mean ah to bh.
+static bool needs_rex(Operand* operand) {
+    return operand && is_register(operand, 1) && operand->reg >= REGISTER_RSP && operand->reg <= REGISTER_RDI;
+}
+
+// Encodes an instruction with a ModRM byte. The reg field is either a register operand, or the
+// opcode extension if there is none. 'trailing' is the number of immediate bytes which follow, as
+// the instruction pointer relative displacement is counted from the end of the instruction.
+static void encode_modrm(MachineCode* code, u32 size, u32 opcode, Operand* reg, u32 extension, Operand* rm, u32 trailing) {
+    u32 reg_field = (reg) ? reg->reg : extension;
+    u32 rm_field  = (rm->kind == OPERAND_SYMBOL) ? 0 : rm->reg;
+
+    u8 rex = 0;
+    if (size == 8)                    rex |= REX | REX_W;
+    if (reg_field & 8)                rex |= REX | REX_R;
+    if (rm_field & 8)                 rex |= REX | REX_B;
+    if (needs_rex(reg) || needs_rex(rm)) rex |= REX;
+
+    if (size == 2) {
+        add_byte(code, 0x66);
+    }
+
+    if (rex) {
+        add_byte(code, rex);
+    }
+
+    add_opcode(code, opcode);
+    reg_field = (reg_field & 7) << 3;
+
+    if (rm->kind == OPERAND_REGISTER) {
+        add_byte(code, 0xc0 | reg_field | (rm_field & 7));
+        return;
+    }
+
+    if (rm->kind == OPERAND_SYMBOL) {
+        add_byte(code, 0x05 | reg_field);
+        add_relocation(code, RELOCATION_PC32, rm->symbol, -(s32)(4 + trailing));
+        return;
+    }
+
+    s64 displacement = rm->value;
+    if (!fits_s32(displacement)) {
+        printf("Assembler : displacement %ld does not fit in 32 bits\n", (long)displacement);
+        exit(1);
+    }
+
+    // rbp and r13 have no form without a displacement, and rsp and r12 need a SIB byte.
+    u32 mod = 2;
+    if (displacement == 0 && (rm_field & 7) != REGISTER_RBP) {
+        mod = 0;
+    }
+    else if (fits_s8(displacement)) {
+        mod = 1;
+    }
+
+    add_byte(code, (mod << 6) | reg_field | (rm_field & 7));
+
+    if ((rm_field & 7) == REGISTER_RSP) {
+        add_byte(code, 0x24);
+    }
+
+    if (mod == 1) {
+        add_value(code, displacement, 1);
+    }
+    else if (mod == 2) {
+        add_value(code, displacement, 4);
+    }
+}
+
+// Encodes the short forms which have the register in the opcode.
+static void encode_register_in_opcode(MachineCode* code, u32 size, u32 opcode, Register reg) {
+    u8 rex = 0;
+    if (size == 8)                                               rex |= REX | REX_W;
+    if (reg & 8)                                                 rex |= REX | REX_B;
+    if (size == 1 && reg >= REGISTER_RSP && reg <= REGISTER_RDI) rex |= REX;
+
+    if (size == 2) {
+        add_byte(code, 0x66);
+    }
+
+    if (rex) {
+        add_byte(code, rex);
+    }
+
+    add_byte(code, opcode + (reg & 7));
+}
+
+static void encode_mov(MachineCode* code, Operand* source, Operand* destination) {
+    if (source->kind == OPERAND_IMMEDIATE && is_register(destination, 0)) {
+        u32 size = destination->size;
+        s64 value = source->value;
+
+        if (size == 8 && fits_s32(value)) {
+            encode_modrm(code, 8, 0xc7, 0, 0, destination, 4);
+            add_value(code, value, 4);
+        }
+        else {
+            encode_register_in_opcode(code, size, (size == 1) ? 0xb0 : 0xb8, destination->reg);
+            add_value(code, value, size);
+        }
+        return;
+    }
+
+    if (is_register(source, 0) && (is_memory(destination) || is_register(destination, source->size))) {
+        encode_modrm(code, source->size, (source->size == 1) ? 0x88 : 0x89, source, 0, destination, 0);
+        return;
+    }
+
+    if (is_memory(source) && is_register(destination, 0)) {
+        encode_modrm(code, destination->size, (destination->size == 1) ? 0x8a : 0x8b, destination, 0, source, 0);
+        return;
+    }
+
+    cannot_encode(MNEMONIC_MOV);
+}
+
+// Add, sub and cmp only differ in the opcodes.
+struct ArithmeticOpcodes {
+    u8 extension;
+    u8 to_rm;
+    u8 from_rm;
+    u8 accumulator;
+};
+
+static const struct ArithmeticOpcodes arithmetic_opcodes[] = {
+    [MNEMONIC_ADD] = { 0, 0x01, 0x03, 0x05 },
+    [MNEMONIC_SUB] = { 5, 0x29, 0x2b, 0x2d },
+    [MNEMONIC_CMP] = { 7, 0x39, 0x3b, 0x3d },
+};
+
+static void encode_arithmetic(MachineCode* code, Mnemonic mnemonic, Operand* source, Operand* destination) {
+    const struct ArithmeticOpcodes* opcodes = &arithmetic_opcodes[mnemonic];
+
+    if (source->kind == OPERAND_IMMEDIATE && is_register(destination, 0)) {
+        u32 size = destination->size;
+        s64 value = source->value;
+
+        if (!fits_s32(value)) {
+            cannot_encode(mnemonic);
+        }
+
+        if (size == 1) {
+            encode_modrm(code, 1, 0x80, 0, opcodes->extension, destination, 1);
+            add_value(code, value, 1);
+        }
+        else if (fits_s8(value)) {
+            encode_modrm(code, size, 0x83, 0, opcodes->extension, destination, 1);
+            add_value(code, value, 1);
+        }
+        else if (destination->reg == REGISTER_RAX) {
+            encode_register_in_opcode(code, size, opcodes->accumulator, REGISTER_RAX);
+            add_value(code, value, (size == 2) ? 2 : 4);
+        }
+        else {
+            encode_modrm(code, size, 0x81, 0, opcodes->extension, destination, (size == 2) ? 2 : 4);
+            add_value(code, value, (size == 2) ? 2 : 4);
+        }
+        return;
+    }
+
+    u32 byte_form = (source->kind == OPERAND_REGISTER && source->size == 1) || (destination->kind == OPERAND_REGISTER && destination->size == 1);
+
+    if (is_register(source, 0) && (is_memory(destination) || is_register(destination, source->size))) {
+        encode_modrm(code, source->size, opcodes->to_rm - byte_form, source, 0, destination, 0);
+        return;
+    }
+
+    if (is_memory(source) && is_register(destination, 0)) {
+        encode_modrm(code, destination->size, opcodes->from_rm - byte_form, destination, 0, source, 0);
+        return;
+    }
+
+    cannot_encode(mnemonic);
+}
+
+static const u8 condition_codes[] = {
+    [MNEMONIC_SETE]  = 0x4,
+    [MNEMONIC_SETNE] = 0x5,
+    [MNEMONIC_SETL]  = 0xc,
+    [MNEMONIC_SETGE] = 0xd,
+    [MNEMONIC_SETLE] = 0xe,
+    [MNEMONIC_SETG]  = 0xf,
+};
+
+// Opcodes of the loads which sign or zero extend into a 64-bit register.
+static const u32 extend_opcodes[] = {
+    [MNEMONIC_MOVSBQ] = 0x0fbe,
+    [MNEMONIC_MOVZBQ] = 0x0fb6,
+    [MNEMONIC_MOVSWQ] = 0x0fbf,
+    [MNEMONIC_MOVZWQ] = 0x0fb7,
+    [MNEMONIC_MOVSXD] = 0x63,
+};
+
+void encode_instruction(MachineCode* code, Mnemonic mnemonic, Operand* operands, u32 operand_count) {
+    Operand* source      = (operand_count >= 1) ? &operands[0] : 0;
+    Operand* destination = (operand_count >= 2) ? &operands[1] : 0;
+
+    switch (mnemonic) {
+        case MNEMONIC_PUSH :
+        case MNEMONIC_POP : {
+            if (operand_count != 1 || !is_register(source, 8)) {
+                cannot_encode(mnemonic);
+            }
+
+            // Push and pop are 64-bit without REX.W.
+            if (source->reg & 8) {
+                add_byte(code, REX | REX_B);
+            }
+
+            add_byte(code, ((mnemonic == MNEMONIC_PUSH) ? 0x50 : 0x58) + (source->reg & 7));
+            break;
+        }
+        case MNEMONIC_MOV : {
+            if (operand_count != 2) {
+                cannot_encode(mnemonic);
+            }
+
+            encode_mov(code, source, destination);
+            break;
+        }
+        case MNEMONIC_MOVSBQ :
+        case MNEMONIC_MOVZBQ :
+        case MNEMONIC_MOVSWQ :
+        case MNEMONIC_MOVZWQ :
+        case MNEMONIC_MOVSXD : {
+            if (operand_count != 2 || !is_register(destination, 8) || !(is_memory(source) || is_register(source, 0))) {
+                cannot_encode(mnemonic);
+            }
+
+            encode_modrm(code, 8, extend_opcodes[mnemonic], destination, 0, source, 0);
+            break;
+        }
+        case MNEMONIC_MOVZB : {
+            if (operand_count != 2 || !is_register(destination, 0) || destination->size < 2 || !(is_memory(source) || is_register(source, 1))) {
+                cannot_encode(mnemonic);
+            }
+
+            encode_modrm(code, destination->size, 0x0fb6, destination, 0, source, 0);
+            break;
+        }
+        case MNEMONIC_LEA : {
+            if (operand_count != 2 || !is_memory(source) || !is_register(destination, 0) || destination->size < 2) {
+                cannot_encode(mnemonic);
+            }
+
+            encode_modrm(code, destination->size, 0x8d, destination, 0, source, 0);
+            break;
+        }
+        case MNEMONIC_ADD :
+        case MNEMONIC_SUB :
+        case MNEMONIC_CMP : {
+            if (operand_count != 2) {
+                cannot_encode(mnemonic);
+            }
+
+            encode_arithmetic(code, mnemonic, source, destination);
+            break;
+        }
+        case MNEMONIC_IMUL : {
+            if (operand_count != 2 || !is_register(destination, 0) || destination->size < 2 || !(is_memory(source) || is_register(source, destination->size))) {
+                cannot_encode(mnemonic);
+            }
+
+            encode_modrm(code, destination->size, 0x0faf, destination, 0, source, 0);
+            break;
+        }
+        case MNEMONIC_IDIV : {
+            if (operand_count != 1 || !is_register(source, 0)) {
+                cannot_encode(mnemonic);
+            }
+
+            encode_modrm(code, source->size, (source->size == 1) ? 0xf6 : 0xf7, 0, 7, source, 0);
+            break;
+        }
+        case MNEMONIC_CDQ : {
+            add_byte(code, 0x99);
+            break;
+        }
+        case MNEMONIC_SETE :
+        case MNEMONIC_SETNE :
+        case MNEMONIC_SETL :
+        case MNEMONIC_SETLE :
+        case MNEMONIC_SETG :
+        case MNEMONIC_SETGE : {
+            if (operand_count != 1 || !(is_register(source, 1) || is_memory(source))) {
+                cannot_encode(mnemonic);
+            }
+
+            encode_modrm(code, 1, 0x0f90 | condition_codes[mnemonic], 0, 0, source, 0);
+            break;
+        }
+        case MNEMONIC_JMP :
+        case MNEMONIC_JE : {
+            if (operand_count != 1) {
+                cannot_encode(mnemonic);
+            }
+
+            if (source->kind == OPERAND_LABEL && source->label.kind != LABEL_STRING) {
+                code->branches = grow_array(code->branches, &code->branch_capacity, code->branch_count, sizeof(Branch));
+                code->branches[code->branch_count++] = (Branch){ .position = code->size, .mnemonic = mnemonic, .label = source->label };
+            }
+            else if (source->kind == OPERAND_SYMBOL) {
+                add_opcode(code, (mnemonic == MNEMONIC_JMP) ? 0xe9 : 0x0f84);
+                add_relocation(code, RELOCATION_PLT32, source->symbol, -4);
+            }
+            else {
+                cannot_encode(mnemonic);
+            }
+            break;
+        }
+        case MNEMONIC_CALL : {
+            if (operand_count != 1 || source->kind != OPERAND_SYMBOL) {
+                cannot_encode(mnemonic);
+            }
+
+            add_byte(code, 0xe8);
+            add_relocation(code, RELOCATION_PLT32, source->symbol, -4);
+            break;
+        }
+        case MNEMONIC_RET : {
+            add_byte(code, 0xc3);
+            break;
+        }
+        case MNEMONIC_SYSCALL : {
+            add_opcode(code, 0x0f05);
+            break;
+        }
+        default : {
+            cannot_encode(mnemonic);
+        }
+    }
+}
+
+void encode_label(MachineCode* code, Label label) {
+    u32 number = (label.kind == LABEL_FUNCTION_END) ? 0 : label.number;
+    u32* count = &code->label_counts[label.kind];
+
+    if (number >= *count) {
+        u32 new_count = (2 * *count > number + 1) ? 2 * *count : number + 1;
+        code->labels[label.kind] = realloc(code->labels[label.kind], new_count * sizeof(LabelPosition));
+        if (code->labels[label.kind] == 0) {
+            printf("Assembler : realloc failed\n");
+            exit(1);
+        }
+
+        for (u32 i = *count; i < new_count; i++) {
+            code->labels[label.kind][i].position = LABEL_NOT_PLACED;
+        }
+
+        *count = new_count;
+    }
+
+    code->labels[label.kind][number] = (LabelPosition){ .position = code->size, .branch_count = code->branch_count };
+}
+
+static u32 get_branch_size(Branch* branch) {
+    if (!branch->is_near) {
+        return 2;
+    }
+
+    return (branch->mnemonic == MNEMONIC_JMP) ? 5 : 6;
+}
+
+static LabelPosition* get_branch_target(MachineCode* code, Branch* branch, String function_name) {
+    Label* label = &branch->label;
+    u32 number = (label->kind == LABEL_FUNCTION_END) ? 0 : label->number;
+
+    if (number >= code->label_counts[label->kind] || code->labels[label->kind][number].position == LABEL_NOT_PLACED) {
+        printf("Assembler : jump to a missing label in %.*s\n", function_name.size, function_name.text);
+        exit(1);
+    }
+
+    return &code->labels[label->kind][number];
+}
+
+void finish_machine_code(MachineCode* code, String function_name, OutputBuffer* fragment) {
+    // shifts[i] is the size of all the branches in front of branch i.
+    u32* shifts = malloc((code->branch_count + 1) * sizeof(u32));
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+        shifts[0] = 0;
+
+        for (u32 i = 0; i < code->branch_count; i++) {
+            shifts[i + 1] = shifts[i] + get_branch_size(&code->branches[i]);
+        }
+
+        for (u32 i = 0; i < code->branch_count; i++) {
+            Branch* branch = &code->branches[i];
+            if (branch->is_near) {
+                continue;
+            }
+
+            LabelPosition* target = get_branch_target(code, branch, function_name);
+            s64 displacement = (s64)(target->position + shifts[target->branch_count]) - (branch->position + shifts[i + 1]);
+
+            if (!fits_s8(displacement)) {
+                branch->is_near = true;
+                changed = true;
+            }
+        }
+    }
+
+    // Splice the branches into the code.
+    u32 size = code->size + shifts[code->branch_count];
+    u8* bytes = malloc(size ? size : 1);
+    u32 cursor = 0;
+    u32 position = 0;
+
+    for (u32 i = 0; i < code->branch_count; i++) {
+        Branch* branch = &code->branches[i];
+
+        __builtin_memcpy(bytes + cursor, code->bytes + position, branch->position - position);
+        cursor += branch->position - position;
+        position = branch->position;
+
+        LabelPosition* target = get_branch_target(code, branch, function_name);
+        s64 displacement = (s64)(target->position + shifts[target->branch_count]) - (branch->position + shifts[i + 1]);
+
+        if (!branch->is_near) {
+            bytes[cursor++] = (branch->mnemonic == MNEMONIC_JMP) ? 0xeb : 0x74;
+            bytes[cursor++] = displacement;
+            continue;
+        }
+
+        if (branch->mnemonic == MNEMONIC_JMP) {
+            bytes[cursor++] = 0xe9;
+        }
+        else {
+            bytes[cursor++] = 0x0f;
+            bytes[cursor++] = 0x84;
+        }
+
+        s32 value = displacement;
+        __builtin_memcpy(bytes + cursor, &value, 4);
+        cursor += 4;
+    }
+
+    __builtin_memcpy(bytes + cursor, code->bytes + position, code->size - position);
+
+    // Relocations are in code order, just like the branches. A relocation is always inside an
+    // instruction, so it can not share its position with a branch.
+    u32 branch_index = 0;
+    for (u32 i = 0; i < code->relocation_count; i++) {
+        Relocation* relocation = &code->relocations[i];
+
+        while (branch_index < code->branch_count && code->branches[branch_index].position <= relocation->offset) {
+            branch_index++;
+        }
+
+        relocation->offset += shifts[branch_index];
+    }
+
+    write_object_symbol(fragment, OBJECT_TEXT, true, function_name, bytes, size, code->relocations, code->relocation_count);
+
+    free(bytes);
+    free(shifts);
+    free(code->bytes);
+    free(code->branches);
+    free(code->relocations);
+
+    for (u32 i = 0; i < LABEL_KIND_COUNT; i++) {
+        free(code->labels[i]);
+    }
+
+    *code = (MachineCode){ 0 };
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static String trim(String string) {
+    while (string.size && is_space(string.text[0])) {
+        string.text++;
+        string.size--;
+    }
+
+    while (string.size && is_space(string.text[string.size - 1])) {
+        string.size--;
+    }
+
+    return string;
+}
+
+static bool is_word_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.';
+}
+
+static bool parse_number(String text, s64* value) {
+    bool negative = false;
+    u32 i = 0;
+
+    if (i < text.size && text.text[i] == '-') {
+        negative = true;
+        i++;
+    }
+
+    u32 base = 10;
+    if (i + 1 < text.size && text.text[i] == '0' && (text.text[i + 1] == 'x' || text.text[i + 1] == 'X')) {
+        base = 16;
+        i += 2;
+    }
+
+    if (i == text.size) {
+        return false;
+    }
+
+    u64 magnitude = 0;
+    for (; i < text.size; i++) {
+        char c = text.text[i];
+        u32 digit;
+
+        if (c >= '0' && c <= '9')                    digit = c - '0';
+        else if (base == 16 && c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (base == 16 && c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return false;
+
+        if (digit >= base) {
+            return false;
+        }
+
+        magnitude = magnitude * base + digit;
+    }
+
+    *value = (negative) ? -(s64)magnitude : (s64)magnitude;
+    return true;
+}
+
+static bool parse_register(String text, Operand* operand) {
+    static const u32 sizes[] = { 1, 2, 4, 8 };
+
+    for (u32 i = 0; i < 4; i++) {
+        for (u32 reg = 0; reg < REGISTER_COUNT; reg++) {
+            String name = get_register_name(reg, sizes[i]);
+
+            if (string_compare(&name, &text)) {
+                *operand = register_operand(reg, sizes[i]);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool parse_operand(String text, Operand* operand) {
+    text = trim(text);
+    if (text.size == 0) {
+        return false;
+    }
+
+    if (text.text[0] == '%') {
+        return parse_register(text, operand);
+    }
+
+    if (text.text[0] == '$') {
+        *operand = immediate_operand(0);
+        return parse_number((String){ .text = text.text + 1, .size = text.size - 1 }, &operand->value);
+    }
+
+    // Displacement from a base register e.g. -8(%rbp).
+    if (text.text[text.size - 1] == ')') {
+        u32 open = 0;
+        while (open < text.size && text.text[open] != '(') {
+            open++;
+        }
+
+        String displacement = { .text = text.text, .size = open };
+        String base = { .text = text.text + open + 1, .size = text.size - open - 2 };
+        Operand base_register;
+
+        if (open == text.size || !parse_register(trim(base), &base_register) || base_register.size != 8) {
+            return false;
+        }
+
+        *operand = memory_operand(base_register.reg, 0);
+        displacement = trim(displacement);
+        return displacement.size == 0 || parse_number(displacement, &operand->value);
+    }
+
+    for (u32 i = 0; i < text.size; i++) {
+        if (!is_word_char(text.text[i])) {
+            return false;
+        }
+    }
+
+    *operand = symbol_operand(text);
+    return true;
+}
+
+static bool parse_mnemonic(String text, Mnemonic* mnemonic) {
+    for (u32 i = 0; i < MNEMONIC_COUNT; i++) {
+        String name = get_mnemonic_name(i);
+
+        if (string_compare(&name, &text)) {
+            *mnemonic = i;
+            return true;
+        }
+    }
+
+    // Size suffixes are allowed, since the operand sizes are taken from the registers.
+    char last = (text.size > 1) ? text.text[text.size - 1] : 0;
+    if (last == 'b' || last == 'w' || last == 'l' || last == 'q') {
+        text.size--;
+
+        for (u32 i = 0; i < MNEMONIC_COUNT; i++) {
+            String name = get_mnemonic_name(i);
+
+            if (string_compare(&name, &text)) {
+                *mnemonic = i;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void encode_assembly_line(MachineCode* code, String line, String function_name) {
+    u32 word = 0;
+    while (word < line.size && is_word_char(line.text[word])) {
+        word++;
+    }
+
+    Mnemonic mnemonic;
+    Operand operands[2];
+    u32 operand_count = 0;
+    bool valid = parse_mnemonic((String){ .text = line.text, .size = word }, &mnemonic);
+
+    // Operands are split at the commas outside of parentheses.
+    String rest = trim((String){ .text = line.text + word, .size = line.size - word });
+    u32 start = 0;
+    u32 depth = 0;
+
+    for (u32 i = 0; valid && rest.size && i <= rest.size; i++) {
+        if (i < rest.size && rest.text[i] == '(') depth++;
+        if (i < rest.size && rest.text[i] == ')') depth--;
+
+        if (i < rest.size && (rest.text[i] != ',' || depth)) {
+            continue;
+        }
+
+        valid = operand_count < 2 && parse_operand((String){ .text = rest.text + start, .size = i - start }, &operands[operand_count]);
+        operand_count++;
+        start = i + 1;
+    }
+
+    if (!valid) {
+        printf("Assembler : can not encode \"%.*s\" in %.*s\n", line.size, line.text, function_name.size, function_name.text);
+        exit(1);
+    }
+
+    encode_instruction(code, mnemonic, operands, operand_count);
+}
+
+void encode_assembly(MachineCode* code, String text, String function_name) {
+    u32 start = 0;
+
+    for (u32 i = 0; i <= text.size; i++) {
+        if (i < text.size && text.text[i] != '\n') {
+            continue;
+        }
+
+        String line = { .text = text.text + start, .size = i - start };
+        start = i + 1;
+
+        // Strip comments.
+        for (u32 j = 0; j < line.size; j++) {
+            if (line.text[j] == '#') {
+                line.size = j;
+                break;
+            }
+        }
+
+        line = trim(line);
+        if (line.size) {
+            encode_assembly_line(code, line, function_name);
+        }
+    }
+}
+
+static u32 hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 16;
+}
+
+u32 decode_string(String string, u8* output) {
+    u32 size = 0;
+
+    for (u32 i = 0; i < string.size; i++) {
+        char c = string.text[i];
+
+        if (c != '\\' || i + 1 == string.size) {
+            output[size++] = c;
+            continue;
+        }
+
+        c = string.text[++i];
+        switch (c) {
+            case 'b' : output[size++] = '\b'; break;
+            case 'f' : output[size++] = '\f'; break;
+            case 'n' : output[size++] = '\n'; break;
+            case 'r' : output[size++] = '\r'; break;
+            case 't' : output[size++] = '\t'; break;
+            case 'x' : {
+                u32 value = 0;
+                while (i + 1 < string.size && hex_digit(string.text[i + 1]) < 16) {
+                    value = (value << 4) | hex_digit(string.text[++i]);
+                }
+
+                output[size++] = value;
+                break;
+            }
+            default : {
+                if (c < '0' || c > '7') {
+                    output[size++] = c;
+                    break;
+                }
+
+                u32 value = c - '0';
+                for (u32 j = 0; j < 2 && i + 1 < string.size && string.text[i + 1] >= '0' && string.text[i + 1] <= '7'; j++) {
+                    value = (value << 3) | (string.text[++i] - '0');
+                }
+
+                output[size++] = value;
+            }
+        }
+    }
+
+    return size;
+}
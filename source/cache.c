@@ -0,0 +1,280 @@
+// Copyright (C) strawberryhacker.
+//
+// This file implements the incremental compilation cache. Every code unit has two entries: the 
+// interface (see interface.c), keyed on the source, and the generated assembly, keyed on the 
+// source and the interfaces of the entire program. A rebuild can therefore skip all the work for 
+// a code unit when neither its source nor any of the global declarations it can see changed.
+//
+// Files are written to a temporary name and renamed into place, so concurrent compilers sharing 
+// a cache directory never see a partial file.
+
+#define _DEFAULT_SOURCE
+#include <cache.h>
+#include <interface.h>
+#include <string.h>
+#include <assert.h>
+#include <thread_pool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define INTERFACE_EXTENSION ".lxi"
+#define OUTPUT_EXTENSION    ".s"
+
+struct Mapping {
+    void* data;
+    u64 size;
+};
+
+static const char* cache_directory;
+static const char* cache_options;
+
+static struct Mapping* mappings;
+static u32 mapping_count;
+static pthread_mutex_t mapping_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static u32 temporary_counter;
+
+void cache_open(const char* directory, const char* options) {
+    if (mkdir(directory, 0755) && errno != EEXIST) {
+        printf("Cache : cannot create the cache directory %s\n", directory);
+        exit(1);
+    }
+
+    cache_directory = directory;
+    cache_options   = options;
+}
+
+bool cache_is_open() {
+    return cache_directory != 0;
+}
+
+void cache_close() {
+    for (u32 i = 0; i < mapping_count; i++) {
+        munmap(mappings[i].data, mappings[i].size);
+    }
+
+    free(mappings);
+    mappings = 0;
+    mapping_count = 0;
+}
+
+// Every key starts out with the compiler version and the options.
+static void start_key(Hash* hash, const char* purpose) {
+    hash_init(hash);
+
+    const char* strings[] = { CACHE_VERSION, __DATE__ " " __TIME__, cache_options, purpose };
+    for (u32 i = 0; i < 4; i++) {
+        String string = make_string(strings[i]);
+
+        // The size is included so that the strings can not run into each other.
+        hash_update(hash, &string.size, sizeof(string.size));
+        hash_update(hash, string.text, string.size);
+    }
+}
+
+static void get_path(char* path, u32 size, u8 key[HASH_SIZE], const char* extension) {
+    char hex[2 * HASH_SIZE + 1];
+    hash_to_hex(key, hex);
+
+    snprintf(path, size, "%s/%s%s", cache_directory, hex, extension);
+}
+
+static bool load_entry(u8 key[HASH_SIZE], const char* extension, String* data) {
+    char path[4096];
+    get_path(path, sizeof(path), key, extension);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) || status.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* memory = mmap(0, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    pthread_mutex_lock(&mapping_lock);
+    mappings = realloc(mappings, (mapping_count + 1) * sizeof(struct Mapping));
+    mappings[mapping_count++] = (struct Mapping){ memory, status.st_size };
+    pthread_mutex_unlock(&mapping_lock);
+
+    data->text = memory;
+    data->size = status.st_size;
+    return true;
+}
+
+static void store_entry(u8 key[HASH_SIZE], const char* extension, OutputBuffer* buffer) {
+    char path[4096];
+    char temporary_path[4096 + 64];
+
+    get_path(path, sizeof(path), key, extension);
+    snprintf(temporary_path, sizeof(temporary_path), "%s.%d.%u.tmp", path, getpid(), __atomic_fetch_add(&temporary_counter, 1, __ATOMIC_RELAXED));
+
+    int fd = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        // The cache is only an optimization, so a read-only cache is not an error.
+        return;
+    }
+
+    output_write(fd, &buffer, 1);
+    close(fd);
+
+    if (rename(temporary_path, path)) {
+        unlink(temporary_path);
+    }
+}
+
+static void hash_output(Hash* hash, OutputBuffer* buffer) {
+    for (OutputBlock* block = buffer->first; block; block = block->next) {
+        hash_update(hash, block->data, block->size);
+    }
+}
+
+void cache_hash_source(CodeUnit* code_unit) {
+    Hash hash;
+    start_key(&hash, "source");
+
+    hash_update(&hash, &code_unit->file_name.size, sizeof(code_unit->file_name.size));
+    hash_update(&hash, code_unit->file_name.text, code_unit->file_name.size);
+    hash_update(&hash, code_unit->source.text, code_unit->source.size);
+
+    hash_final(&hash, code_unit->source_hash);
+}
+
+void cache_store_interface(CodeUnit* code_unit, OutputBuffer* interface) {
+    Hash hash;
+    hash_init(&hash);
+    hash_output(&hash, interface);
+    hash_final(&hash, code_unit->interface_hash);
+
+    code_unit->has_interface = true;
+    store_entry(code_unit->source_hash, INTERFACE_EXTENSION, interface);
+}
+
+void cache_find_interfaces(CodeUnit** code_units, u32 count) {
+    if (!cache_is_open()) {
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        CodeUnit* code_unit = code_units[i];
+        String data;
+
+        // An imported module is its own interface.
+        if (code_unit->is_imported) {
+            Hash hash;
+            hash_init(&hash);
+            hash_update(&hash, code_unit->source.text, code_unit->source.size - 1);
+            hash_final(&hash, code_unit->interface_hash);
+
+            code_unit->has_interface = true;
+            continue;
+        }
+
+        if (!load_entry(code_unit->source_hash, INTERFACE_EXTENSION, &data)) {
+            continue;
+        }
+
+        if (!read_interface(code_unit, data)) {
+            printf("Cache : ignoring a broken interface for %.*s\n", code_unit->file_name.size, code_unit->file_name.text);
+            continue;
+        }
+
+        Hash hash;
+        hash_init(&hash);
+        hash_update(&hash, data.text, data.size);
+        hash_final(&hash, code_unit->interface_hash);
+
+        code_unit->has_interface = true;
+        code_unit->is_cached     = true;
+    }
+}
+
+static bool has_inferred_globals(CodeUnit* code_unit) {
+    ListNode* it;
+    list_iterate(it, &code_unit->global_scope->variables) {
+        Declaration* declaration = list_to_struct(it, Declaration, list_node);
+
+        if (declaration->type->kind == TYPE_INFERRED) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void cache_find_outputs(CodeUnit** code_units, u32 count) {
+    if (!cache_is_open()) {
+        return;
+    }
+
+    // The interfaces of the entire program, in the order the files are given.
+    Hash hash;
+    start_key(&hash, "program");
+    bool has_inferred = false;
+
+    for (u32 i = 0; i < count; i++) {
+        assert(code_units[i]->has_interface);
+        hash_update(&hash, code_units[i]->interface_hash, HASH_SIZE);
+
+        has_inferred |= has_inferred_globals(code_units[i]);
+    }
+
+    // An inferred global gets its type from an assignment in any function body, which is not part
+    // of the interfaces. The output then depends on the source of every code unit.
+    if (has_inferred) {
+        for (u32 i = 0; i < count; i++) {
+            if (!code_units[i]->is_imported) {
+                hash_update(&hash, code_units[i]->source_hash, HASH_SIZE);
+            }
+        }
+    }
+
+    u8 program_hash[HASH_SIZE];
+    hash_final(&hash, program_hash);
+
+    for (u32 i = 0; i < count; i++) {
+        CodeUnit* code_unit = code_units[i];
+
+        start_key(&hash, "output");
+        hash_update(&hash, code_unit->source_hash, HASH_SIZE);
+        hash_update(&hash, program_hash, HASH_SIZE);
+        hash_final(&hash, code_unit->output_key);
+
+        if (code_unit->is_cached && !load_entry(code_unit->output_key, OUTPUT_EXTENSION, &code_unit->cached_output)) {
+            // Some other code unit changed its interface. This one has to be compiled again, 
+            // starting from the source.
+            code_unit->is_cached    = false;
+            code_unit->global_scope = 0;
+        }
+    }
+}
+
+void cache_store_outputs(Program* program) {
+    if (!cache_is_open()) {
+        return;
+    }
+
+    ListNode* it;
+    list_iterate(it, &program->code_units) {
+        CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
+
+        if (!code_unit->is_cached && !code_unit->is_imported) {
+            store_entry(code_unit->output_key, OUTPUT_EXTENSION, &code_unit->output);
+        }
+    }
+}
@@ -0,0 +1,248 @@
+// Copyright (C) strawberryhacker.
+//
+// This file drives a compilation from the command line options to the output file. It is shared
+// by the regular command line compiler and the compile server, which keeps some of the code units
+// parsed between the compilations.
+
+#include <compile.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <parser.h>
+#include <tree_printer.h>
+#include <generator.h>
+#include <typer.h>
+#include <arena.h>
+#include <source.h>
+#include <thread_pool.h>
+#include <cache.h>
+#include <trace.h>
+#include <interface.h>
+#include <reachability.h>
+
+void print_usage() {
+    printf("Usage : luxury [-j threads] [--cache directory] [--time] [--memory] [--quiet] [--trace file] [--interface file] [--reachable] <input files...> <output file>\n");
+    printf("        luxury --serve <socket>\n");
+    printf("        luxury --connect <socket> <options and files...>\n");
+    printf("        The thread count given with -j must be between 1 and %d\n", MAX_THREAD_COUNT);
+    printf("        The output file is assembly if it ends in .s, an ELF object if it ends in .o, and an executable otherwise\n");
+    printf("        With --reachable only the functions which main can reach are compiled, and the cache is not used\n");
+    printf("        Input files ending in .lxi are the interface files of imported modules, written with --interface\n");
+}
+
+bool is_option(const char* argument, const char* option) {
+    String a = make_string(argument);
+    String b = make_string(option);
+    return string_compare(&a, &b);
+}
+
+// Parses the argument of -j. Anything but a whole number from one up to the maximum is rejected.
+static bool parse_thread_count(const char* argument, u32* thread_count) {
+    char* end;
+    errno = 0;
+    long count = strtol(argument, &end, 10);
+
+    if (errno || end == argument || *end != 0 || count < 1 || count > MAX_THREAD_COUNT) {
+        return false;
+    }
+
+    *thread_count = count;
+    return true;
+}
+
+bool parse_options(Options* options, int argument_count, char** arguments) {
+    *options = (Options){ .thread_count = get_processor_count(), .print_tree = true };
+
+    while (argument_count >= 2 && arguments[0][0] == '-') {
+        // These options do not take an argument.
+        if (is_option(arguments[0], "--time") || is_option(arguments[0], "--memory") || is_option(arguments[0], "--quiet") || is_option(arguments[0], "--reachable")) {
+            options->print_time     |= is_option(arguments[0], "--time");
+            options->print_memory   |= is_option(arguments[0], "--memory");
+            options->print_tree     &= !is_option(arguments[0], "--quiet");
+            options->reachable_only |= is_option(arguments[0], "--reachable");
+            arguments++;
+            argument_count--;
+            continue;
+        }
+
+        if (is_option(arguments[0], "-j")) {
+            if (!parse_thread_count(arguments[1], &options->thread_count)) {
+                return false;
+            }
+        }
+        else if (is_option(arguments[0], "--cache")) {
+            options->cache_directory = arguments[1];
+        }
+        else if (is_option(arguments[0], "--trace")) {
+            options->trace_file = arguments[1];
+        }
+        else if (is_option(arguments[0], "--interface")) {
+            options->interface_file = arguments[1];
+        }
+        else {
+            return false;
+        }
+
+        arguments += 2;
+        argument_count -= 2;
+    }
+
+    if (argument_count < 2) {
+        return false;
+    }
+
+    options->input_files = (const char **)arguments;
+    options->input_count = argument_count - 1;
+    options->output_file = arguments[options->input_count];
+    return true;
+}
+
+void compile(Options* options, LoadCodeUnits load) {
+    const char** input_files = options->input_files;
+    u32 input_count = options->input_count;
+    const char* output_file = options->output_file;
+
+    if (options->print_time || options->trace_file) {
+        trace_enable();
+    }
+
+    if (options->print_memory) {
+        arena_enable_statistics();
+    }
+
+    for (u32 i = 0; i < input_count; i++) {
+        printf("Input file  : %s\n", input_files[i]);
+    }
+    printf("Output file : %s\n", output_file);
+
+    // The function bodies are typed in parallel, so even a single file can use all the threads.
+    ThreadPool* pool = new_thread_pool(options->thread_count);
+
+    OutputFormat format = OUTPUT_EXECUTABLE;
+    if (has_extension(output_file, ".s")) {
+        format = OUTPUT_ASSEMBLY;
+    }
+    else if (has_extension(output_file, ".o")) {
+        format = OUTPUT_OBJECT;
+    }
+
+    // The output format is the only option which changes the cached output. Objects and 
+    // executables are made from the same fragments. The functions which are used depend on the 
+    // entire program, and not just on the interfaces, so the cache can not be used for them.
+    if (options->cache_directory && options->reachable_only) {
+        printf("Cache : not used with --reachable\n");
+    }
+    else if (options->cache_directory) {
+        cache_open(options->cache_directory, (format == OUTPUT_ASSEMBLY) ? "" : "object");
+    }
+    
+    // Build the syntax tree. Code units with a cached interface are not parsed, unless their 
+    // cached output turns out to be missing.
+    arena_enter_phase(ARENA_PARSE);
+    CodeUnit** code_units = calloc(input_count, sizeof(CodeUnit*));
+
+    // The compile server may have changed this while parsing the resident files.
+    parser_set_skimming(options->reachable_only);
+
+    if (load == 0) {
+        load = load_code_units;
+    }
+
+    u64 start = trace_time();
+    load(code_units, input_files, input_count, pool);
+    trace_event("phase", make_string("load"), start);
+
+    start = trace_time();
+    cache_find_interfaces(code_units, input_count);
+    parse_code_units(code_units, input_count, pool);
+    cache_find_outputs(code_units, input_count);
+    parse_code_units(code_units, input_count, pool);
+    trace_event("phase", make_string("parse"), start);
+
+    start = trace_time();
+    Program* program = link_code_units(code_units, input_count);
+    trace_event("phase", make_string("link"), start);
+
+    // Only the bodies of the functions which are used are parsed.
+    if (options->reachable_only) {
+        start = trace_time();
+        mark_unused_functions(program, options->interface_file != 0);
+        parse_function_bodies(program, pool);
+        trace_event("phase", make_string("reachability"), start);
+    }
+    else {
+        // Resident code units which the compile server parsed for a --reachable request still 
+        // have their bodies skimmed. There is nothing to do for the others.
+        parse_function_bodies(program, pool);
+    }
+
+    if (options->print_tree) {
+        start = trace_time();
+        print_program(program);
+        trace_event("phase", make_string("print parsed tree"), start);
+    }
+
+    printf("Typing starting\n");
+
+    // Type the syntax tree.
+    arena_enter_phase(ARENA_TYPE);
+    start = trace_time();
+    type_program(program, pool);
+    trace_event("phase", make_string("type"), start);
+
+    // The module interface holds the resolved types, while the cached interfaces are written 
+    // straight after parsing.
+    if (options->interface_file) {
+        start = trace_time();
+        write_module_interface(options->interface_file, code_units, input_count);
+        trace_event("phase", make_string("write interface"), start);
+    }
+
+    free(code_units);
+
+    if (options->print_tree) {
+        start = trace_time();
+        print_program(program);
+        trace_event("phase", make_string("print typed tree"), start);
+    }
+
+    // Generate the output file from the typed syntax tree.
+    arena_enter_phase(ARENA_CODEGEN);
+    start = trace_time();
+    generator_init(output_file, format);
+    generate_program(program, pool);
+    trace_event("phase", make_string("generate"), start);
+
+    start = trace_time();
+    cache_store_outputs(program);
+    trace_event("phase", make_string("store cache"), start);
+
+    free_thread_pool(pool);
+
+    // The event names point into the tree and the sources, so the trace is reported before they 
+    // are released.
+    if (options->print_time) {
+        trace_print_summary();
+    }
+
+    if (options->trace_file) {
+        trace_write(options->trace_file);
+    }
+
+    if (options->print_memory) {
+        arena_print_statistics();
+    }
+
+    // The code units live in the arenas, so the sources are unloaded before the arenas are 
+    // released. Nothing reads the tree past this point.
+    ListNode* it;
+    list_iterate(it, &program->code_units) {
+        CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
+        output_release(&code_unit->output);
+        unload_source_file(&code_unit->source);
+    }
+
+    cache_close();
+    arena_release_all();
+}
@@ -0,0 +1,368 @@
+// Copyright (C) strawberryhacker.
+//
+// This file turns the instructions from the generator into AT&T assembly text. Mnemonics, 
+// registers and label prefixes are stored with their sizes, and numbers are formatted by hand, so
+// every instruction is just a handful of appends to the output buffer.
+//
+// In object mode the instructions are handed to the assembler instead, and the data entries are
+// written as object symbols. Comments and headers only exist in the text.
+
+#include <emitter.h>
+#include <assembler.h>
+#include <object.h>
+#include <arena.h>
+#include <output.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define TEXT(string) { .text = string, .size = sizeof(string) - 1 }
+
+static const String mnemonics[] = {
+    [MNEMONIC_PUSH]   = TEXT("    push"),
+    [MNEMONIC_POP]    = TEXT("    pop"),
+    [MNEMONIC_MOV]    = TEXT("    mov"),
+    [MNEMONIC_MOVSBQ] = TEXT("    movsbq"),
+    [MNEMONIC_MOVZBQ] = TEXT("    movzbq"),
+    [MNEMONIC_MOVSWQ] = TEXT("    movswq"),
+    [MNEMONIC_MOVZWQ] = TEXT("    movzwq"),
+    [MNEMONIC_MOVSXD] = TEXT("    movsxd"),
+    [MNEMONIC_MOVZB]  = TEXT("    movzb"),
+    [MNEMONIC_LEA]    = TEXT("    lea"),
+    [MNEMONIC_ADD]    = TEXT("    add"),
+    [MNEMONIC_SUB]    = TEXT("    sub"),
+    [MNEMONIC_IMUL]   = TEXT("    imul"),
+    [MNEMONIC_IDIV]   = TEXT("    idiv"),
+    [MNEMONIC_CDQ]    = TEXT("    cdq"),
+    [MNEMONIC_CMP]    = TEXT("    cmp"),
+    [MNEMONIC_SETE]   = TEXT("    sete"),
+    [MNEMONIC_SETNE]  = TEXT("    setne"),
+    [MNEMONIC_SETL]   = TEXT("    setl"),
+    [MNEMONIC_SETLE]  = TEXT("    setle"),
+    [MNEMONIC_SETG]   = TEXT("    setg"),
+    [MNEMONIC_SETGE]  = TEXT("    setge"),
+    [MNEMONIC_JMP]    = TEXT("    jmp"),
+    [MNEMONIC_JE]     = TEXT("    je"),
+    [MNEMONIC_CALL]   = TEXT("    call"),
+    [MNEMONIC_RET]    = TEXT("    ret"),
+    [MNEMONIC_SYSCALL] = TEXT("    syscall"),
+};
+
+// Register names indexed by the size in bytes. The '%' prefix is included.
+static const String registers[9][REGISTER_COUNT] = {
+    [1] = {
+        TEXT("%al"),  TEXT("%cl"),  TEXT("%dl"),   TEXT("%bl"),   TEXT("%spl"),  TEXT("%bpl"),  
+        TEXT("%sil"), TEXT("%dil"), TEXT("%r8b"),  TEXT("%r9b"),  TEXT("%r10b"), TEXT("%r11b"), 
+        TEXT("%r12b"), TEXT("%r13b"), TEXT("%r14b"), TEXT("%r15b"),
+    },
+    [2] = {
+        TEXT("%ax"),  TEXT("%cx"),  TEXT("%dx"),   TEXT("%bx"),   TEXT("%sp"),   TEXT("%bp"),   
+        TEXT("%si"),  TEXT("%di"),  TEXT("%r8w"),  TEXT("%r9w"),  TEXT("%r10w"), TEXT("%r11w"), 
+        TEXT("%r12w"), TEXT("%r13w"), TEXT("%r14w"), TEXT("%r15w"),
+    },
+    [4] = {
+        TEXT("%eax"), TEXT("%ecx"), TEXT("%edx"),  TEXT("%ebx"),  TEXT("%esp"),  TEXT("%ebp"),  
+        TEXT("%esi"), TEXT("%edi"), TEXT("%r8d"),  TEXT("%r9d"),  TEXT("%r10d"), TEXT("%r11d"), 
+        TEXT("%r12d"), TEXT("%r13d"), TEXT("%r14d"), TEXT("%r15d"),
+    },
+    [8] = {
+        TEXT("%rax"), TEXT("%rcx"), TEXT("%rdx"),  TEXT("%rbx"),  TEXT("%rsp"),  TEXT("%rbp"),  
+        TEXT("%rsi"), TEXT("%rdi"), TEXT("%r8"),   TEXT("%r9"),   TEXT("%r10"),  TEXT("%r11"),  
+        TEXT("%r12"), TEXT("%r13"), TEXT("%r14"),  TEXT("%r15"),
+    },
+};
+
+static const String label_prefixes[] = {
+    [LABEL_LOOP_START]   = TEXT("loop.start."),
+    [LABEL_LOOP_END]     = TEXT("loop.end."),
+    [LABEL_IF_FALSE]     = TEXT("if.false."),
+    [LABEL_IF_END]       = TEXT("if.end."),
+    [LABEL_FUNCTION_END] = TEXT("end."),
+    [LABEL_STRING]       = TEXT("string."),
+};
+
+// The text and data sections are assembled separately, and are only joined when written.
+static _Thread_local Emitter* emitter;
+
+static OutputFormat output_format;
+
+// Appends a string literal.
+#define append_literal(buffer, literal) output_add(buffer, literal, sizeof(literal) - 1)
+
+static inline void append_string(OutputBuffer* buffer, String string) {
+    output_add(buffer, string.text, string.size);
+}
+
+static void append_number(OutputBuffer* buffer, s64 value) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* cursor = end;
+
+    u64 magnitude = (value < 0) ? -(u64)value : (u64)value;
+    do {
+        *--cursor = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0) {
+        *--cursor = '-';
+    }
+
+    output_add(buffer, cursor, end - cursor);
+}
+
+static void append_label(OutputBuffer* buffer, Label* label) {
+    assert(label->kind < LABEL_KIND_COUNT);
+    append_string(buffer, label_prefixes[label->kind]);
+
+    if (label->kind == LABEL_FUNCTION_END) {
+        append_string(buffer, label->name);
+    }
+    else {
+        append_string(buffer, emitter->function_name);
+        append_literal(buffer, ".");
+        append_number(buffer, label->number);
+    }
+}
+
+static void append_operand(OutputBuffer* buffer, Operand* operand) {
+    switch (operand->kind) {
+        case OPERAND_REGISTER : {
+            assert(operand->size <= 8 && registers[operand->size][operand->reg].size);
+            append_string(buffer, registers[operand->size][operand->reg]);
+            break;
+        }
+        case OPERAND_IMMEDIATE : {
+            append_literal(buffer, "$");
+            append_number(buffer, operand->value);
+            break;
+        }
+        case OPERAND_MEMORY : {
+            if (operand->value) {
+                append_number(buffer, operand->value);
+            }
+
+            append_literal(buffer, "(");
+            append_string(buffer, registers[8][operand->reg]);
+            append_literal(buffer, ")");
+            break;
+        }
+        case OPERAND_SYMBOL : {
+            append_string(buffer, operand->symbol);
+            break;
+        }
+        case OPERAND_LABEL : {
+            append_label(buffer, &operand->label);
+            break;
+        }
+        default : {
+            printf("Emitter : operand kind %d not handled\n", operand->kind);
+            exit(1);
+        }
+    }
+}
+
+// String labels are symbols in the object, since they are referenced from the data section. The 
+// name is the same as in the text, and it lives in the arena until the object is written.
+static String get_string_symbol(Label* label) {
+    OutputBuffer buffer;
+    output_init(&buffer);
+    append_label(&buffer, label);
+
+    String name = { .text = phase_allocate(ALLOCATION_OTHER, buffer.size), .size = 0 };
+    for (OutputBlock* block = buffer.first; block; block = block->next) {
+        __builtin_memcpy(name.text + name.size, block->data, block->size);
+        name.size += block->size;
+    }
+
+    output_release(&buffer);
+    return name;
+}
+
+static void encode_operands(Mnemonic mnemonic, Operand* operands, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        if (operands[i].kind == OPERAND_LABEL && operands[i].label.kind == LABEL_STRING) {
+            operands[i] = symbol_operand(get_string_symbol(&operands[i].label));
+        }
+    }
+
+    encode_instruction(emitter->code, mnemonic, operands, count);
+}
+
+void emitter_set_format(OutputFormat format) {
+    output_format = format;
+}
+
+String get_mnemonic_name(Mnemonic mnemonic) {
+    assert(mnemonic < MNEMONIC_COUNT);
+
+    // Skip the indentation.
+    String name = mnemonics[mnemonic];
+    return (String){ .text = name.text + 4, .size = name.size - 4 };
+}
+
+String get_register_name(Register reg, u32 size) {
+    assert(size <= 8 && reg < REGISTER_COUNT);
+    return registers[size][reg];
+}
+
+void emitter_init(Emitter* new_emitter, String function_name) {
+    output_init(&new_emitter->text);
+    output_init(&new_emitter->data);
+    new_emitter->function_name = function_name;
+    new_emitter->code = 0;
+
+    if (output_format == OUTPUT_OBJECT && function_name.size) {
+        new_emitter->code = calloc(1, sizeof(MachineCode));
+    }
+}
+
+void set_emitter(Emitter* new_emitter) {
+    emitter = new_emitter;
+}
+
+void emitter_collect(Emitter* emitters, u32 count, OutputBuffer* output) {
+    u64 data_size = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        if (emitters[i].code) {
+            finish_machine_code(emitters[i].code, emitters[i].function_name, &emitters[i].text);
+            free(emitters[i].code);
+            emitters[i].code = 0;
+        }
+
+        data_size += emitters[i].data.size;
+        output_append(output, &emitters[i].text);
+    }
+
+    if (data_size && output_format == OUTPUT_ASSEMBLY) {
+        append_literal(output, "\n    .data\n");
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        output_append(output, &emitters[i].data);
+    }
+}
+
+void emit_instruction(Mnemonic mnemonic) {
+    if (output_format == OUTPUT_OBJECT) {
+        encode_operands(mnemonic, 0, 0);
+        return;
+    }
+
+    append_string(&emitter->text, mnemonics[mnemonic]);
+    append_literal(&emitter->text, "\n");
+}
+
+void emit_instruction1(Mnemonic mnemonic, Operand operand) {
+    if (output_format == OUTPUT_OBJECT) {
+        encode_operands(mnemonic, &operand, 1);
+        return;
+    }
+
+    append_string(&emitter->text, mnemonics[mnemonic]);
+    append_literal(&emitter->text, " ");
+    append_operand(&emitter->text, &operand);
+    append_literal(&emitter->text, "\n");
+}
+
+void emit_instruction2(Mnemonic mnemonic, Operand source, Operand destination) {
+    if (output_format == OUTPUT_OBJECT) {
+        Operand operands[] = { source, destination };
+        encode_operands(mnemonic, operands, 2);
+        return;
+    }
+
+    append_string(&emitter->text, mnemonics[mnemonic]);
+    append_literal(&emitter->text, " ");
+    append_operand(&emitter->text, &source);
+    append_literal(&emitter->text, ", ");
+    append_operand(&emitter->text, &destination);
+    append_literal(&emitter->text, "\n");
+}
+
+void emit_label(Label label) {
+    if (output_format == OUTPUT_OBJECT) {
+        encode_label(emitter->code, label);
+        return;
+    }
+
+    append_label(&emitter->text, &label);
+    append_literal(&emitter->text, ":\n");
+}
+
+void emit_function_start(String name) {
+    // The function symbol is added when the function is finished.
+    if (output_format == OUTPUT_OBJECT) {
+        return;
+    }
+
+    append_literal(&emitter->text, "\n    .text\n    .globl ");
+    append_string(&emitter->text, name);
+    append_literal(&emitter->text, "\n");
+    append_string(&emitter->text, name);
+    append_literal(&emitter->text, ":\n");
+}
+
+void emit_assembly(String body) {
+    if (output_format == OUTPUT_OBJECT) {
+        encode_assembly(emitter->code, body, emitter->function_name);
+        return;
+    }
+
+    append_literal(&emitter->text, "    ");
+    append_string(&emitter->text, body);
+    append_literal(&emitter->text, "\n");
+}
+
+void emit_comment(String comment) {
+    if (output_format == OUTPUT_OBJECT) {
+        return;
+    }
+
+    append_literal(&emitter->text, "\n    # ");
+    append_string(&emitter->text, comment);
+    append_literal(&emitter->text, "\n");
+}
+
+void emit_code_unit_header(String file_name) {
+    if (output_format == OUTPUT_OBJECT) {
+        return;
+    }
+
+    append_literal(&emitter->text, "# Code unit : ");
+    append_string(&emitter->text, file_name);
+    append_literal(&emitter->text, "\n# ------------------------------------------------------\n\n");
+}
+
+void emit_data_string(Label label, String string) {
+    if (output_format == OUTPUT_OBJECT) {
+        u8* bytes = malloc(string.size + 1);
+        u32 size = decode_string(string, bytes);
+        bytes[size++] = 0;
+
+        write_object_symbol(&emitter->data, OBJECT_DATA, false, get_string_symbol(&label), bytes, size, 0, 0);
+        free(bytes);
+        return;
+    }
+
+    append_label(&emitter->data, &label);
+    append_literal(&emitter->data, ":\n    .string \"");
+    append_string(&emitter->data, string);
+    append_literal(&emitter->data, "\"\n");
+}
+
+void emit_data_zero(String name, u32 size) {
+    // Global variables are visible to the programs which import the module.
+    if (output_format == OUTPUT_OBJECT) {
+        write_object_symbol(&emitter->data, OBJECT_BSS, true, name, 0, size, 0, 0);
+        return;
+    }
+
+    append_literal(&emitter->data, "    .globl ");
+    append_string(&emitter->data, name);
+    append_literal(&emitter->data, "\n");
+    append_string(&emitter->data, name);
+    append_literal(&emitter->data, ":\n    .zero ");
+    append_number(&emitter->data, size);
+    append_literal(&emitter->data, "\n");
+}
@@ -9,17 +9,37 @@ const u32 LINE_COUNT = 3;
 #define NORMAL  "\x1B[0m"
 #define RED     "\x1B[31m"
 
-// This will print an error message based on the token. The token will contain a pointer to the 
-// lexer for additional information.The format will be the following:
+// This will print an error message based on the token. The lexer of the token has the source for 
+// additional information. The format will be the following:
 // 
 //   3 | data := 3;
 //   4 | 
 //   5 | main : func () -> u2 {
 //                         ^^
 //                         message
-void error_token(Token* token, const char* message, ...) {
-    const char* start   = token->lexer->file.text;
-    const char* current = token->name.text;
+void error_token(u32 token, const char* message, ...) {
+    Lexer* lexer = get_token_lexer(token);
+    String name  = get_token_name(token);
+
+    // The source is not loaded for tokens coming from a cached interface.
+    if (lexer->is_interface) {
+        static char buffer[1024];
+
+        va_list arg;
+        va_start(arg, message);
+        u32 size = vsnprintf(buffer, 1024, message, arg);
+        va_end(arg);
+
+        printf(RED "Error: " NORMAL "%.*s : %.*s\n\n", name.size, name.text, size, buffer);
+        exit(1);
+    }
+
+    u32 line;
+    u32 column;
+    get_token_location(token, &line, &column);
+
+    const char* start   = lexer->file.text;
+    const char* current = name.text;
 
     // Trace back 'LINE_COUNT' number of lines.
     u32 i = 0;
@@ -44,7 +64,7 @@ void error_token(Token* token, const char* message, ...) {
 
     printf(RED "Error: \n" NORMAL);
 
-    u32 line = token->line - i + 1;
+    line = line - i + 1;
 
     for (u32 j = 0; j < i; j++) {
         printf(" %3d | ", line++);
@@ -66,17 +86,17 @@ void error_token(Token* token, const char* message, ...) {
 
     printf("       ");
 
-    for (u32 i = 0; i < token->column; i++) {
+    for (u32 i = 0; i < column; i++) {
         printf(" ");
     }
 
-    for (u32 i = 0; i < token->name.size; i++) {
+    for (u32 i = 0; i < name.size; i++) {
         printf("^");
     }
 
     printf("\n       ");
 
-    for (u32 i = 0; i < token->column; i++) {
+    for (u32 i = 0; i < column; i++) {
         printf(" ");
     }
 
@@ -1,71 +1,61 @@
 #include <generator.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <list.h>
 #include <assert.h>
 #include <error.h>
-#include <array.h>
+#include <emitter.h>
+#include <object.h>
+#include <trace.h>
 
 static void generate_statement(Statement* statement);
 static void generate_expression(Expression* expression);
 
 // Function arguments will be placed in these registers according to the SystemV ABI.
-const char* argument_registers1[] = { "dil", "sil", "dl" , "cl" , "r8b", "r9b" };
-const char* argument_registers2[] = { "di" , "si" , "dx" , "cx" , "r8w", "r9w" };
-const char* argument_registers4[] = { "edi", "esi", "edx", "ecx", "r8d", "r9d" };
-const char* argument_registers8[] = { "rdi", "rsi", "rdx", "rcx", "r8",  "r9"  };
-
-File* file;
-u32 stack_level = 0;
-Declaration* current_function_declaration;
-Array* data_segment;
-
-void emit(const char* data, ...) {
-    static char buffer[1024];
-
-    va_list arg;
-    va_start(arg, data);
-    u32 size = vsnprintf(buffer, 1024, data, arg);
-    va_end(arg);
-
-    fwrite(buffer, 1, size, file);
-    fputc('\n', file);
+static const Register argument_registers[] = {
+    REGISTER_RDI, REGISTER_RSI, REGISTER_RDX, REGISTER_RCX, REGISTER_R8, REGISTER_R9
+};
+
+int output_fd;
+static OutputFormat output_format;
+
+// The output is written to a temporary file next to it, and only renamed over the output file once
+// it is complete. Errors exit the process, so a failed compilation removes the temporary file on 
+// exit, and never leaves a partial or empty output behind.
+static const char* output_path;
+static char* temporary_path;
+
+// Functions are generated in parallel, so all the state used while generating a function is 
+// thread local. It is reset at the start of every function.
+static _Thread_local u32 stack_level;
+static _Thread_local Declaration* current_function_declaration;
+static _Thread_local u32 string_counter;
+static _Thread_local u32 loop_counter;
+static _Thread_local u32 if_counter;
+
+static Operand rax() {
+    return register_operand(REGISTER_RAX, 8);
 }
 
-void emit_data(const char* data, ...) {
-    va_list arg;
-    va_start(arg, data);
-    array_add_va_list(data_segment, data, arg);
-    va_end(arg);
-
-    array_add(data_segment, "\n");
-}
-
-void emit_data_segment() {
-    if (data_segment->size == 0) {
-        return;
-    }
-
-    emit("");
-    emit("    .data");
-
-    fwrite(data_segment->buffer, 1, data_segment->size, file);
-    data_segment->size = 0;
+static Operand rdi() {
+    return register_operand(REGISTER_RDI, 8);
 }
 
 void push_rax() {
-    emit("    push %%rax");
+    emit_instruction1(MNEMONIC_PUSH, rax());
     stack_level++;
 }
 
 void pop_rdi() {
-    emit("    pop %%rdi");
+    emit_instruction1(MNEMONIC_POP, rdi());
     stack_level--;
 }
 
-void pop(const char* reg) {
-    emit("    pop %%%s", reg);
+void pop(Register reg) {
+    emit_instruction1(MNEMONIC_POP, register_operand(reg, 8));
     stack_level--;
 }
 
@@ -75,10 +65,11 @@ static void generate_address(Expression* expression) {
 
         if (expression->primary.declaration->is_global) {
             String name = expression->primary.declaration->name;
-            emit("    lea %.*s, %%rax", name.size, name.text);
+            emit_instruction2(MNEMONIC_LEA, symbol_operand(name), rax());
         }
         else {
-            emit("    lea %d(%%rbp), %%rax", expression->primary.declaration->variable.offset);
+            s32 offset = expression->primary.declaration->variable.offset;
+            emit_instruction2(MNEMONIC_LEA, memory_operand(REGISTER_RBP, offset), rax());
         }
     }
     else if (is_deref(expression)) {
@@ -86,7 +77,7 @@ static void generate_address(Expression* expression) {
     }
     else if (expression->kind == EXPRESSION_DOT) {
         generate_address(expression->dot.expression);
-        emit("    add $%d, %%rax", expression->dot.offset);
+        emit_instruction2(MNEMONIC_ADD, immediate_operand(expression->dot.offset), rax());
     }
     else {
         printf("Generator (address) : cannot generate address of this.\n");
@@ -110,24 +101,36 @@ static void load_from_rax(Type* type) {
         return;
     }
 
-    char c = (type_is_signed(type)) ? 's' : 'z';
+    bool is_signed = type_is_signed(type);
+    Operand address = memory_operand(REGISTER_RAX, 0);
+
     switch (type->size) {
-        case 1 : emit("    mov%cbq (%%rax), %%rax", c); break;
-        case 2 : emit("    mov%cwq (%%rax), %%rax", c); break;
-        case 4 : emit("    movsxd (%%rax), %%rax", c); break;
-        case 8 : emit("    mov (%%rax), %%rax");        break;
+        case 1 : emit_instruction2((is_signed) ? MNEMONIC_MOVSBQ : MNEMONIC_MOVZBQ, address, rax()); break;
+        case 2 : emit_instruction2((is_signed) ? MNEMONIC_MOVSWQ : MNEMONIC_MOVZWQ, address, rax()); break;
+        case 4 : emit_instruction2(MNEMONIC_MOVSXD, address, rax()); break;
+        case 8 : emit_instruction2(MNEMONIC_MOV, address, rax());    break;
     }
 }
 
 static void store_to_rdi(Type* type) {
     switch (type->size) {
-        case 1 : emit("    mov %%al,  (%%rdi)"); break;
-        case 2 : emit("    mov %%ax,  (%%rdi)"); break;
-        case 4 : emit("    mov %%eax, (%%rdi)"); break;
-        case 8 : emit("    mov %%rax, (%%rdi)"); break;
+        case 1 :
+        case 2 :
+        case 4 :
+        case 8 : {
+            emit_instruction2(MNEMONIC_MOV, register_operand(REGISTER_RAX, type->size), memory_operand(REGISTER_RDI, 0));
+            break;
+        }
     }
 }
 
+// Compares rax with rdi and sets rax to one if the condition holds, otherwise zero.
+static void compare(Mnemonic set) {
+    emit_instruction2(MNEMONIC_CMP, rdi(), rax());
+    emit_instruction1(set, register_operand(REGISTER_RAX, 1));
+    emit_instruction2(MNEMONIC_MOVZB, register_operand(REGISTER_RAX, 1), register_operand(REGISTER_RAX, 4));
+}
+
 static void generate_binary_expression(Expression* expression) {
     Binary* binary = &expression->binary;
 
@@ -156,57 +159,44 @@ static void generate_binary_expression(Expression* expression) {
     // rax rdi
     switch (binary->kind) {
         case BINARY_PLUS : {
-            emit("    add %%rdi, %%rax");
+            emit_instruction2(MNEMONIC_ADD, rdi(), rax());
             break;
         }
         case BINARY_MINUS : {
-            emit("    sub %%rdi, %%rax");
+            emit_instruction2(MNEMONIC_SUB, rdi(), rax());
             break;
         }
         case BINARY_MULTIPLICATION : {
-            emit("    imul %%rdi, %%rax");
+            emit_instruction2(MNEMONIC_IMUL, rdi(), rax());
             break;
         }
         case BINARY_DIVISION : {
-            emit("    cdq");
-            emit("    idiv %%rdi");
+            emit_instruction(MNEMONIC_CDQ);
+            emit_instruction1(MNEMONIC_IDIV, rdi());
             break;
         }
         case BINARY_EQUAL : {
-            emit("    cmp %%rdi, %%rax");
-            emit("    sete %%al");
-            emit("    movzb %%al, %%eax");
+            compare(MNEMONIC_SETE);
             break;
         }
         case BINARY_LESS : {
-            emit("    cmp %%rdi, %%rax");
-            emit("    setl %%al");
-            emit("    movzb %%al, %%eax");
+            compare(MNEMONIC_SETL);
             break;
         }
         case BINARY_LESS_EQUAL : {
-            emit("    cmp %%rdi, %%rax");
-            emit("    setle %%al");
-            emit("    movzb %%al, %%eax");
+            compare(MNEMONIC_SETLE);
             break;
         }
         case BINARY_GREATER : {
-            emit("    cmp %%rdi, %%rax");
-            emit("    setg %%al");
-            emit("    movzb %%al, %%eax");
+            compare(MNEMONIC_SETG);
             break;
         }
         case BINARY_GREATER_EQUAL : {
-            emit("    cmp %%rdi, %%rax");
-            emit("    setge %%al");
-            emit("    movzb %%al, %%eax");
+            compare(MNEMONIC_SETGE);
             break;
         }
-
         case BINARY_NOT_EQUAL : {
-            emit("    cmp %%rdi, %%rax");
-            emit("    setne %%al");
-            emit("    movzb %%al, %%eax");
+            compare(MNEMONIC_SETNE);
             break;
         }
         default : {
@@ -220,7 +210,7 @@ static void generate_primary_expression(Expression* expression) {
 
     switch (primary->kind) {
         case PRIMARY_NUMBER : {
-            emit("    mov $%d, %%rax", primary->number);
+            emit_instruction2(MNEMONIC_MOV, immediate_operand(primary->number), rax());
             break;
         }
         case PRIMARY_IDENTIFIER : {
@@ -229,15 +219,11 @@ static void generate_primary_expression(Expression* expression) {
             break;
         }
         case PRIMARY_STRING : {
-            static u32 string_number = 0;
+            u32 number = string_counter++;
 
             // Just emit the string.
-            emit_data("string.%d:", string_number);
-            emit_data("    .string \"%.*s\"", primary->string.size, primary->string.text);
-
-            emit("    lea string.%d, %%rax", string_number);
-
-            string_number++;
+            emit_data_string((Label){ .kind = LABEL_STRING, .number = number }, get_token_name(primary->token));
+            emit_instruction2(MNEMONIC_LEA, label_operand(LABEL_STRING, number), rax());
             break;
         }
         default : {
@@ -266,23 +252,21 @@ static void generate_unary_expression(Expression* expression) {
 static void generate_call_expression(Expression* expression) {
     Call* call = &expression->call;
 
-    u32 argument_count = 0;
-    ListNode* it;
-    list_iterate(it, &call->arguments) {
-        Expression* expr = list_to_struct(it, Expression, list_node);
-        generate_expression(expr);
+    u32 argument_count = call->argument_count;
+
+    for (u32 i = 0; i < argument_count; i++) {
+        generate_expression(call->arguments[i]);
         push_rax();
-        argument_count++;
     }
 
     while(argument_count--) {
-        pop(argument_registers8[argument_count]);
+        pop(argument_registers[argument_count]);
     }
 
-    emit("    mov $0, %%rax");
+    emit_instruction2(MNEMONIC_MOV, immediate_operand(0), rax());
 
-    String name = call->expression->primary.name;
-    emit("    call %.*s", name.size, name.text);
+    String name = get_token_name(call->expression->primary.token);
+    emit_instruction1(MNEMONIC_CALL, symbol_operand(name));
 }
 
 static void generate_dot_expression(Expression* expression) {
@@ -324,10 +308,8 @@ static void generate_expression(Expression* expression) {
 static void generate_compound_statement(Statement* statement) {
     Compound* compound = &statement->compound;
 
-    ListNode* it;
-    list_iterate(it, &compound->statements) {
-        Statement* statement = list_to_struct(it, Statement, list_node);
-        generate_statement(statement);
+    for (u32 i = 0; i < compound->statement_count; i++) {
+        generate_statement(compound->statements[i]);
     }
 }
 
@@ -335,57 +317,52 @@ static void generate_return_statement(Statement* statement) {
     generate_expression(statement->Return.return_expression);
     assert(current_function_declaration);
     String name = current_function_declaration->name;
-    emit("    jmp end.%.*s", name.size, name.text);
+    emit_instruction1(MNEMONIC_JMP, function_end_operand(name));
 }
 
 static void generate_loop_statement(Statement* statement) {
-    static u32 loop_counter = 0;
-
     Loop* loop = &statement->loop;
     u32 number = loop_counter++;
 
     if (loop->init_statement) {
         generate_statement(loop->init_statement);
     }
-    emit("loop.start.%d:", number);
+    emit_label((Label){ .kind = LABEL_LOOP_START, .number = number });
 
     generate_expression(loop->condition);
-    emit("    cmp $0, %%rax");
-    emit("    je loop.end.%d", number);
+    emit_instruction2(MNEMONIC_CMP, immediate_operand(0), rax());
+    emit_instruction1(MNEMONIC_JE, label_operand(LABEL_LOOP_END, number));
 
     generate_statement(loop->body);
 
     if (loop->post_statement) {
         generate_statement(loop->post_statement);
     }
-    emit("    jmp loop.start.%d", number);
+    emit_instruction1(MNEMONIC_JMP, label_operand(LABEL_LOOP_START, number));
 
-    emit("loop.end.%d:", number);
+    emit_label((Label){ .kind = LABEL_LOOP_END, .number = number });
 }
 
 static void generate_conditional_statement(Statement* statement) {
-    static u32 if_counter = 0;
-
     Conditional* cond = &statement->conditional;
     u32 number = if_counter++;
 
     generate_expression(cond->condition);
-    emit("    cmp $0, %%rax");
-    emit("    je if.false.%d", number);
+    emit_instruction2(MNEMONIC_CMP, immediate_operand(0), rax());
+    emit_instruction1(MNEMONIC_JE, label_operand(LABEL_IF_FALSE, number));
     generate_statement(cond->true_body);
-    emit("    jmp if.end.%d", number);
+    emit_instruction1(MNEMONIC_JMP, label_operand(LABEL_IF_END, number));
     
-    emit("if.false.%d:", number);
+    emit_label((Label){ .kind = LABEL_IF_FALSE, .number = number });
     if (cond->false_body) {
         generate_statement(cond->false_body);
     }
 
-    emit("if.end.%d:", number);
+    emit_label((Label){ .kind = LABEL_IF_END, .number = number });
 }
 
 static void generate_comment_statement(Statement* statement) {
-    String comment = statement->comment.token->name;
-    emit("\n    # %.*s", comment.size, comment.text);
+    emit_comment(get_token_name(statement->comment.token));
 }
 
 static void generate_statement(Statement* statement) {
@@ -460,28 +437,27 @@ static u32 compute_local_variable_offset(Function* function) {
 
 static void generate_function(Declaration* declaration) {
     current_function_declaration = declaration;
+    stack_level    = 0;
+    string_counter = 0;
+    loop_counter   = 0;
+    if_counter     = 0;
+
     Function* function = &declaration->function;
     String name = declaration->name;
 
     if (function->assembly_function) {
-        emit("");
-        emit("    .text");
-        emit("    .globl %.*s", name.size, name.text);
-        emit("%.*s:", name.size, name.text);
-        emit("    %.*s", function->assembly_body.size, function->assembly_body.text);
+        emit_function_start(name);
+        emit_assembly(function->assembly_body);
         return;
     }
 
     u32 frame_size = compute_local_variable_offset(function);
 
-    emit("");
-    emit("    .text");
-    emit("    .globl %.*s", name.size, name.text);
-    emit("%.*s:", name.size, name.text);
+    emit_function_start(name);
 
-    emit("    push %%rbp");
-    emit("    mov %%rsp, %%rbp");
-    emit("    sub $%d, %%rsp", frame_size);
+    emit_instruction1(MNEMONIC_PUSH, register_operand(REGISTER_RBP, 8));
+    emit_instruction2(MNEMONIC_MOV, register_operand(REGISTER_RSP, 8), register_operand(REGISTER_RBP, 8));
+    emit_instruction2(MNEMONIC_SUB, immediate_operand(frame_size), register_operand(REGISTER_RSP, 8));
 
     // Store the argument registers on the assigned place on the stack frame.
     u32 reg = 0;
@@ -493,17 +469,11 @@ static void generate_function(Declaration* declaration) {
 
         Declaration* decl = list_to_struct(it, Declaration, list_node);
 
-        if (decl->type->size == 1) {
-            emit("    mov %%%s, %d(%%rbp)", argument_registers1[reg++], decl->variable.offset);
-        }
-        else if (decl->type->size == 2) {
-            emit("    mov %%%s, %d(%%rbp)", argument_registers2[reg++], decl->variable.offset);
-        }
-        else if (decl->type->size == 4) {
-            emit("    mov %%%s, %d(%%rbp)", argument_registers4[reg++], decl->variable.offset);
-        }
-        else if (decl->type->size == 8) {
-            emit("    mov %%%s, %d(%%rbp)", argument_registers8[reg++], decl->variable.offset);
+        u32 size = decl->type->size;
+
+        if (size == 1 || size == 2 || size == 4 || size == 8) {
+            Operand source = register_operand(argument_registers[reg++], size);
+            emit_instruction2(MNEMONIC_MOV, source, memory_operand(REGISTER_RBP, decl->variable.offset));
         }
     }
 
@@ -511,60 +481,186 @@ static void generate_function(Declaration* declaration) {
     generate_statement(function->body);
     assert(stack_level == 0);
 
-    emit("end.%.*s:", name.size, name.text);
-    emit("    mov %%rbp, %%rsp");
-    emit("    pop %%rbp");
-    emit("    ret");
-
-    emit_data_segment();
+    emit_label((Label){ .kind = LABEL_FUNCTION_END, .name = name });
+    emit_instruction2(MNEMONIC_MOV, register_operand(REGISTER_RBP, 8), register_operand(REGISTER_RSP, 8));
+    emit_instruction1(MNEMONIC_POP, register_operand(REGISTER_RBP, 8));
+    emit_instruction(MNEMONIC_RET);
 }
 
-static void generate_scope(Scope* scope) {
+// The output is split into one item per code unit, holding the header and the global variables, 
+// followed by one item per function in the code unit. Every item has its own emitter, and the 
+// emitters are written in item order, so the output does not depend on the thread timing.
+struct GenerateItem {
+    CodeUnit* code_unit;
+    Declaration* function;
+};
+
+struct GenerateJob {
+    struct GenerateItem* items;
+    Emitter* emitters;
+};
+
+static void generate_globals(CodeUnit* code_unit) {
+    emit_code_unit_header(code_unit->file_name);
+
     ListNode* it;
-    list_iterate(it, &scope->functions) {
-        Declaration* decl = list_to_struct(it, Declaration, list_node);
-        assert(decl->kind == DECLARATION_FUNCTION);
-        generate_function(decl);
+    list_iterate(it, &code_unit->global_scope->variables) {
+        Declaration* declaration = list_to_struct(it, Declaration, list_node);
+
+        emit_data_zero(declaration->name, declaration->type->size);
     }
+}
+
+static void generate_item(void* context, u32 index) {
+    struct GenerateJob* job = context;
+    struct GenerateItem* item = &job->items[index];
+
+    set_emitter(&job->emitters[index]);
+    u64 start = trace_time();
+
+    if (item->function) {
+        generate_function(item->function);
+        trace_event("generate", item->function->name, start);
+    }
+    else {
+        generate_globals(item->code_unit);
+        trace_event("generate", item->code_unit->file_name, start);
+    }
+}
+
+void generate_program(Program* program, ThreadPool* pool) {
+    u32 item_count = 0;
+    u32 code_unit_count = 0;
+
+    ListNode* it;
+    list_iterate(it, &program->code_units) {
+        CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
+        code_unit_count++;
+
+        // The output of cached code units is already known, and imported code units have none.
+        if (code_unit->is_cached || code_unit->is_imported) {
+            continue;
+        }
 
-    if (scope->parent == 0) {
-        // Global scope.
-        ListNode* it;
-        list_iterate(it, &scope->variables) {
-            Declaration* declaration = list_to_struct(it, Declaration, list_node);
+        item_count++;
 
-            emit_data("%.*s:", declaration->name.size, declaration->name.text);
-            emit_data("    .zero %d", declaration->type->size);
+        ListNode* function_it;
+        list_iterate(function_it, &code_unit->global_scope->functions) {
+            Declaration* declaration = list_to_struct(function_it, Declaration, list_node);
+            item_count += !declaration->function.is_unused;
         }
     }
 
-    emit_data_segment();
-}
+    struct GenerateItem* items = calloc(item_count, sizeof(struct GenerateItem));
+    Emitter* emitters = calloc(item_count, sizeof(Emitter));
+    u32 index = 0;
 
-static void generate_code_unit(CodeUnit* code_unit) {
-    String name = code_unit->file_name;
+    list_iterate(it, &program->code_units) {
+        CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
 
-    emit("# Code unit : %.*s", name.size, name.text);
-    emit("# ------------------------------------------------------\n");
+        if (code_unit->is_cached || code_unit->is_imported) {
+            continue;
+        }
 
-    generate_scope(code_unit->global_scope);
-}
+        emitter_init(&emitters[index], (String){ 0 });
+        items[index++].code_unit = code_unit;
+
+        ListNode* function_it;
+        list_iterate(function_it, &code_unit->global_scope->functions) {
+            Declaration* declaration = list_to_struct(function_it, Declaration, list_node);
+            assert(declaration->kind == DECLARATION_FUNCTION);
+
+            if (declaration->function.is_unused) {
+                continue;
+            }
+
+            emitter_init(&emitters[index], declaration->name);
+            items[index].code_unit = code_unit;
+            items[index++].function = declaration;
+        }
+    }
+
+    struct GenerateJob job = { .items = items, .emitters = emitters };
+    thread_pool_run(pool, generate_item, &job, item_count);
+
+    // Every code unit gets its own output, such that it can be cached on its own.
+    OutputBuffer** outputs = calloc(code_unit_count, sizeof(OutputBuffer*));
+    u32 output_count = 0;
+    index = 0;
 
-void generate_program(Program* program) {
-    
-    ListNode* it;
     list_iterate(it, &program->code_units) {
         CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
+        output_init(&code_unit->output);
+
+        if (code_unit->is_cached) {
+            output_add(&code_unit->output, code_unit->cached_output.text, code_unit->cached_output.size);
+        }
+        else if (!code_unit->is_imported) {
+            u32 count = 1;
+            while (index + count < item_count && items[index + count].code_unit == code_unit) {
+                count++;
+            }
+
+            emitter_collect(&emitters[index], count, &code_unit->output);
+            index += count;
+        }
+
+        outputs[output_count++] = &code_unit->output;
+    }
 
-        generate_code_unit(code_unit);
+    if (output_format == OUTPUT_OBJECT) {
+        write_object_file(output_fd, outputs, output_count);
+    }
+    else if (output_format == OUTPUT_EXECUTABLE) {
+        write_executable_file(output_fd, outputs, output_count);
+    }
+    else {
+        output_write(output_fd, outputs, output_count);
     }
+
+    close(output_fd);
+
+    if (rename(temporary_path, output_path)) {
+        printf("Generator : cannot create %s\n", output_path);
+        exit(56);
+    }
+
+    free(temporary_path);
+    temporary_path = 0;
+
+    free(outputs);
+    free(items);
+    free(emitters);
 }
 
-void generator_init(const char* output_file) {
-    file = fopen(output_file, "w");
-    if (file == 0) {
+static void remove_temporary_output() {
+    if (temporary_path) {
+        unlink(temporary_path);
+    }
+}
+
+void generator_init(const char* output_file, OutputFormat format) {
+    output_format = format;
+    emitter_set_format((format == OUTPUT_ASSEMBLY) ? OUTPUT_ASSEMBLY : OUTPUT_OBJECT);
+
+    u32 size = make_string(output_file).size + 32;
+    temporary_path = malloc(size);
+    snprintf(temporary_path, size, "%s.%d.tmp", output_file, getpid());
+    output_path = output_file;
+
+    static bool is_registered;
+    if (!is_registered) {
+        atexit(remove_temporary_output);
+        is_registered = true;
+    }
+
+    output_fd = open(temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output_fd < 0) {
         exit(56);
     }
 
-    data_segment = new_array();
+    // The mode is not subject to the umask this way.
+    if (format == OUTPUT_EXECUTABLE && fchmod(output_fd, 0755) < 0) {
+        exit(56);
+    }
 }
\ No newline at end of file
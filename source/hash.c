@@ -0,0 +1,147 @@
+// Copyright (C) strawberryhacker.
+//
+// This file implements SHA-256 as described in FIPS 180-4.
+
+#include <hash.h>
+
+static const u32 round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline u32 rotate_right(u32 value, u32 count) {
+    return (value >> count) | (value << (32 - count));
+}
+
+static void hash_block(Hash* hash, const u8* block) {
+    u32 w[64];
+
+    for (u32 i = 0; i < 16; i++) {
+        w[i] = (u32)block[4 * i] << 24 | (u32)block[4 * i + 1] << 16 | (u32)block[4 * i + 2] << 8 | block[4 * i + 3];
+    }
+
+    for (u32 i = 16; i < 64; i++) {
+        u32 s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        u32 s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    u32 a = hash->state[0];
+    u32 b = hash->state[1];
+    u32 c = hash->state[2];
+    u32 d = hash->state[3];
+    u32 e = hash->state[4];
+    u32 f = hash->state[5];
+    u32 g = hash->state[6];
+    u32 h = hash->state[7];
+
+    for (u32 i = 0; i < 64; i++) {
+        u32 s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+        u32 choice = (e & f) ^ (~e & g);
+        u32 t1 = h + s1 + choice + round_constants[i] + w[i];
+        u32 s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+        u32 majority = (a & b) ^ (a & c) ^ (b & c);
+        u32 t2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    hash->state[0] += a;
+    hash->state[1] += b;
+    hash->state[2] += c;
+    hash->state[3] += d;
+    hash->state[4] += e;
+    hash->state[5] += f;
+    hash->state[6] += g;
+    hash->state[7] += h;
+}
+
+void hash_init(Hash* hash) {
+    static const u32 initial_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    for (u32 i = 0; i < 8; i++) {
+        hash->state[i] = initial_state[i];
+    }
+
+    hash->length     = 0;
+    hash->block_size = 0;
+}
+
+void hash_update(Hash* hash, const void* data, u64 size) {
+    const u8* bytes = data;
+    hash->length += size;
+
+    // Fill up a partial block first.
+    while (size && hash->block_size) {
+        hash->block[hash->block_size++] = *bytes++;
+        size--;
+
+        if (hash->block_size == 64) {
+            hash_block(hash, hash->block);
+            hash->block_size = 0;
+        }
+    }
+
+    // Whole blocks are hashed straight from the input.
+    while (size >= 64) {
+        hash_block(hash, bytes);
+        bytes += 64;
+        size  -= 64;
+    }
+
+    while (size--) {
+        hash->block[hash->block_size++] = *bytes++;
+    }
+}
+
+void hash_final(Hash* hash, u8 digest[HASH_SIZE]) {
+    u64 bit_length = hash->length * 8;
+
+    u8 padding = 0x80;
+    hash_update(hash, &padding, 1);
+
+    padding = 0;
+    while (hash->block_size != 56) {
+        hash_update(hash, &padding, 1);
+    }
+
+    u8 length[8];
+    for (u32 i = 0; i < 8; i++) {
+        length[i] = bit_length >> (56 - 8 * i);
+    }
+
+    hash_update(hash, length, 8);
+
+    for (u32 i = 0; i < 8; i++) {
+        digest[4 * i]     = hash->state[i] >> 24;
+        digest[4 * i + 1] = hash->state[i] >> 16;
+        digest[4 * i + 2] = hash->state[i] >> 8;
+        digest[4 * i + 3] = hash->state[i];
+    }
+}
+
+void hash_to_hex(u8 digest[HASH_SIZE], char* buffer) {
+    static const char digits[] = "0123456789abcdef";
+
+    for (u32 i = 0; i < HASH_SIZE; i++) {
+        *buffer++ = digits[digest[i] >> 4];
+        *buffer++ = digits[digest[i] & 15];
+    }
+
+    *buffer = 0;
+}
@@ -0,0 +1,473 @@
+// Copyright (C) strawberryhacker.
+//
+// This file converts the global declarations of a code unit to and from the binary interface 
+// format. The format is a plain pre-order walk of the declarations and their types:
+//
+//   interface   : magic, declaration count, declaration...
+//   declaration : kind, name, type                                      (variables and typedefs)
+//               | kind, name, is_assembly, return type, count, (name, type)...     (functions)
+//   type        : kind, ...
+//   name        : size, text
+//
+// Numbers are stored in host byte order, since the interface never leaves the machine.
+//
+// The same format is used for the interface files of modules. A module is compiled once into an 
+// object file and an interface file, and programs which import the module give the interface file
+// as an input instead of the sources. The file is mapped, and only the declarations are read.
+
+#include <interface.h>
+#include <typer.h>
+#include <intern.h>
+#include <arena.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Type kind used for a missing type e.g. a function without a return type.
+#define TYPE_NONE 0
+
+static Type** basic_types[] = {
+    &type_u64, &type_u32, &type_u16, &type_u8, &type_s64, &type_s32, &type_s16, &type_s8, &type_char,
+};
+
+#define BASIC_TYPE_COUNT (sizeof(basic_types) / sizeof(basic_types[0]))
+
+static void write_u8(OutputBuffer* buffer, u8 value) {
+    output_add(buffer, (const char *)&value, 1);
+}
+
+static void write_u32(OutputBuffer* buffer, u32 value) {
+    output_add(buffer, (const char *)&value, 4);
+}
+
+static void write_name(OutputBuffer* buffer, String name) {
+    write_u32(buffer, name.size);
+    output_add(buffer, name.text, name.size);
+}
+
+// A module interface is written after typing, when a named type is no longer referred to by name
+// but by the structure it resolved to. These structures are written by name again, such that the
+// importer gets one structure per typedef, and self-referencing structures do not recurse.
+struct NamedTypes {
+    Declaration** declarations;
+    u32 count;
+};
+
+static Declaration* lookup_named_type(struct NamedTypes* named, Type* type) {
+    if (named == 0 || type->kind != TYPE_STRUCT) {
+        return 0;
+    }
+
+    // This only runs when a module interface is written, so a linear search is fine.
+    for (u32 i = 0; i < named->count; i++) {
+        if (named->declarations[i]->type == type) {
+            return named->declarations[i];
+        }
+    }
+
+    return 0;
+}
+
+static void write_type(OutputBuffer* buffer, Type* type, struct NamedTypes* named);
+
+// Writes the type itself, even if it is a named type.
+static void write_type_structure(OutputBuffer* buffer, Type* type, struct NamedTypes* named) {
+    write_u8(buffer, type->kind);
+
+    switch (type->kind) {
+        case TYPE_BASIC : {
+            u32 index = 0;
+            while (index < BASIC_TYPE_COUNT && *basic_types[index] != type) {
+                index++;
+            }
+
+            assert(index < BASIC_TYPE_COUNT);
+            write_u8(buffer, index);
+            break;
+        }
+        case TYPE_POINTER : {
+            write_u32(buffer, type->pointer.count);
+            write_type(buffer, type->pointer.pointer_to, named);
+            break;
+        }
+        case TYPE_UNKNOWN : {
+            write_name(buffer, get_token_name(type->unknown.token));
+            break;
+        }
+        case TYPE_STRUCT : {
+            write_u8(buffer, type->Struct.is_struct);
+            write_u8(buffer, type->Struct.scope != 0);
+            write_u32(buffer, list_get_size(&type->Struct.members));
+
+            ListNode* it;
+            list_iterate(it, &type->Struct.members) {
+                StructMember* member = list_to_struct(it, StructMember, list_node);
+
+                write_u8(buffer, member->is_anonymous);
+                if (!member->is_anonymous) {
+                    write_name(buffer, member->name);
+                }
+
+                write_type(buffer, member->type, named);
+            }
+            break;
+        }
+        case TYPE_INFERRED :
+        case TYPE_VOID : {
+            break;
+        }
+        default : {
+            printf("Interface : type kind %d not handled\n", type->kind);
+            exit(1);
+        }
+    }
+}
+
+static void write_type(OutputBuffer* buffer, Type* type, struct NamedTypes* named) {
+    if (type == 0) {
+        write_u8(buffer, TYPE_NONE);
+        return;
+    }
+
+    Declaration* named_type = lookup_named_type(named, type);
+    if (named_type) {
+        write_u8(buffer, TYPE_UNKNOWN);
+        write_name(buffer, named_type->name);
+        return;
+    }
+
+    write_type_structure(buffer, type, named);
+}
+
+static void write_declarations(OutputBuffer* buffer, List* declarations, struct NamedTypes* named) {
+    ListNode* it;
+    list_iterate(it, declarations) {
+        Declaration* declaration = list_to_struct(it, Declaration, list_node);
+
+        write_u8(buffer, declaration->kind);
+        write_name(buffer, declaration->name);
+
+        // The structure of a typedef is written out, and not just its own name.
+        if (declaration->kind == DECLARATION_TYPE && declaration->type->kind == TYPE_STRUCT) {
+            write_type_structure(buffer, declaration->type, named);
+            continue;
+        }
+
+        if (declaration->kind != DECLARATION_FUNCTION) {
+            write_type(buffer, declaration->type, named);
+            continue;
+        }
+
+        Function* function = &declaration->function;
+        List* arguments = &function->function_scope->variables;
+
+        write_u8(buffer, function->assembly_function);
+        write_type(buffer, function->return_type, named);
+        write_u32(buffer, list_get_size(arguments));
+
+        ListNode* argument_it;
+        list_iterate(argument_it, arguments) {
+            Declaration* argument = list_to_struct(argument_it, Declaration, list_node);
+
+            write_name(buffer, argument->name);
+            write_type(buffer, argument->type, named);
+        }
+    }
+}
+
+// Writes the declarations of all the code units as one interface. The typedefs go first, such that
+// the order matches the one of a single code unit.
+static void write_code_units(OutputBuffer* buffer, CodeUnit** code_units, u32 count, struct NamedTypes* named) {
+    u32 declaration_count = 0;
+    for (u32 i = 0; i < count; i++) {
+        Scope* scope = code_units[i]->global_scope;
+        declaration_count += list_get_size(&scope->types) + list_get_size(&scope->variables) + list_get_size(&scope->functions);
+    }
+
+    write_u32(buffer, INTERFACE_MAGIC);
+    write_u32(buffer, declaration_count);
+
+    for (u32 i = 0; i < count; i++) {
+        write_declarations(buffer, &code_units[i]->global_scope->types, named);
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        write_declarations(buffer, &code_units[i]->global_scope->variables, named);
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        write_declarations(buffer, &code_units[i]->global_scope->functions, named);
+    }
+}
+
+void write_interface(OutputBuffer* buffer, CodeUnit* code_unit) {
+    write_code_units(buffer, &code_unit, 1, 0);
+}
+
+void write_module_interface(const char* file_name, CodeUnit** code_units, u32 count) {
+    OutputBuffer buffer;
+    output_init(&buffer);
+
+    // Imported modules are not exported again, but their types may still be used by name.
+    CodeUnit** exported = calloc(count, sizeof(CodeUnit*));
+    u32 exported_count = 0;
+
+    struct NamedTypes named = { 0 };
+    bool has_inferred = false;
+
+    for (u32 i = 0; i < count; i++) {
+        Scope* scope = code_units[i]->global_scope;
+
+        ListNode* it;
+        list_iterate(it, &scope->types) {
+            named.declarations = realloc(named.declarations, (named.count + 1) * sizeof(Declaration*));
+            named.declarations[named.count++] = list_to_struct(it, Declaration, list_node);
+        }
+
+        if (code_units[i]->is_imported) {
+            continue;
+        }
+
+        exported[exported_count++] = code_units[i];
+
+        // A global which is never assigned keeps the inferred type, and the importer has no way
+        // of resolving it.
+        list_iterate(it, &scope->variables) {
+            Declaration* declaration = list_to_struct(it, Declaration, list_node);
+
+            if (declaration->type->kind == TYPE_INFERRED) {
+                printf("Interface : the type of the global %.*s is never inferred\n", declaration->name.size, declaration->name.text);
+                has_inferred = true;
+            }
+        }
+    }
+
+    if (has_inferred) {
+        exit(1);
+    }
+
+    write_code_units(&buffer, exported, exported_count, &named);
+    free(named.declarations);
+    free(exported);
+
+    int fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("Interface : cannot create %s\n", file_name);
+        exit(1);
+    }
+
+    OutputBuffer* buffers[] = { &buffer };
+    output_write(fd, buffers, 1);
+    output_release(&buffer);
+    close(fd);
+}
+
+struct Reader {
+    const char* cursor;
+    const char* end;
+    bool failed;
+
+    // Hands out the tokens for the names, which the error reporting points at.
+    Lexer* lexer;
+};
+
+static bool can_read(struct Reader* reader, u32 size) {
+    if (reader->failed || (u64)(reader->end - reader->cursor) < size) {
+        reader->failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+static u8 read_u8(struct Reader* reader) {
+    if (!can_read(reader, 1)) {
+        return 0;
+    }
+
+    return *reader->cursor++;
+}
+
+static u32 read_u32(struct Reader* reader) {
+    u32 value = 0;
+    if (can_read(reader, 4)) {
+        __builtin_memcpy(&value, reader->cursor, 4);
+        reader->cursor += 4;
+    }
+
+    return value;
+}
+
+static String read_name(struct Reader* reader) {
+    String name = { 0 };
+    name.size = read_u32(reader);
+
+    if (can_read(reader, name.size)) {
+        name.text = (char *)reader->cursor;
+        reader->cursor += name.size;
+    }
+    else {
+        name.size = 0;
+    }
+
+    return name;
+}
+
+
+static Type* read_type(struct Reader* reader, StructScope* struct_scope) {
+    u8 kind = read_u8(reader);
+
+    switch (kind) {
+        case TYPE_NONE : {
+            return 0;
+        }
+        case TYPE_BASIC : {
+            u8 index = read_u8(reader);
+            if (index >= BASIC_TYPE_COUNT) {
+                reader->failed = true;
+                return 0;
+            }
+
+            return *basic_types[index];
+        }
+        case TYPE_POINTER : {
+            Type* type = new_pointer();
+            type->pointer.count      = read_u32(reader);
+            type->pointer.pointer_to = read_type(reader, struct_scope);
+            return type;
+        }
+        case TYPE_UNKNOWN : {
+            Type* type = new_type(TYPE_UNKNOWN);
+            type->unknown.token = add_interface_token(reader->lexer, read_name(reader));
+            return type;
+        }
+        case TYPE_STRUCT : {
+            StructType* type = new_struct();
+            type->is_struct = read_u8(reader);
+
+            // Members of anonymous structures are reached through the enclosing tagged structure,
+            // just like the parser does it.
+            if (read_u8(reader)) {
+                type->scope = new_struct_scope();
+                type->scope->parent = struct_scope;
+                struct_scope = type->scope;
+            }
+
+            u32 count = read_u32(reader);
+            for (u32 i = 0; i < count && !reader->failed; i++) {
+                StructMember* member = new_struct_member();
+                member->is_anonymous = read_u8(reader);
+
+                if (!member->is_anonymous) {
+                    member->name   = read_name(reader);
+                    member->token  = add_interface_token(reader->lexer, member->name);
+                    member->symbol = get_token_symbol(member->token);
+                }
+
+                member->type = read_type(reader, struct_scope);
+                list_add_last(&member->list_node, &type->members);
+
+                if (!member->is_anonymous) {
+                    if (struct_scope == 0) {
+                        reader->failed = true;
+                        return 0;
+                    }
+
+                    list_add_last(&member->scope_node, &struct_scope->members);
+                }
+            }
+
+            return (Type *)type;
+        }
+        case TYPE_INFERRED :
+        case TYPE_VOID : {
+            return new_type(kind);
+        }
+    }
+
+    reader->failed = true;
+    return 0;
+}
+
+static void add_declaration(Scope* scope, Declaration* declaration) {
+    list_add_last(&declaration->list_node, get_declaration_list(scope, declaration->kind));
+    table_insert(get_declaration_index(scope, declaration->kind), declaration->symbol, declaration);
+}
+
+static Declaration* read_declaration(struct Reader* reader, Scope* scope) {
+    Declaration* declaration = new_declaration();
+
+    declaration->kind       = read_u8(reader);
+    declaration->name       = read_name(reader);
+    declaration->name_token = add_interface_token(reader->lexer, declaration->name);
+    declaration->symbol     = get_token_symbol(declaration->name_token);
+
+    if (declaration->kind == DECLARATION_VARIABLE || declaration->kind == DECLARATION_TYPE) {
+        declaration->type      = read_type(reader, 0);
+        declaration->is_global = (declaration->kind == DECLARATION_VARIABLE);
+        return declaration;
+    }
+
+    if (declaration->kind != DECLARATION_FUNCTION) {
+        reader->failed = true;
+        return declaration;
+    }
+
+    // The function scope only holds the arguments. There is no body.
+    Function* function = &declaration->function;
+
+    function->function_scope = new_scope();
+    function->function_scope->parent = scope;
+    function->function_scope->depth  = scope->depth + 1;
+    list_add_last(&function->function_scope->list_node, &scope->child_scopes);
+
+    function->assembly_function = read_u8(reader);
+    function->return_type = read_type(reader, 0);
+
+    u32 count = read_u32(reader);
+    for (u32 i = 0; i < count && !reader->failed; i++) {
+        Declaration* argument = new_declaration();
+
+        argument->kind       = DECLARATION_VARIABLE;
+        argument->name       = read_name(reader);
+        argument->name_token = add_interface_token(reader->lexer, argument->name);
+        argument->symbol     = get_token_symbol(argument->name_token);
+        argument->type       = read_type(reader, 0);
+
+        add_declaration(function->function_scope, argument);
+    }
+
+    return declaration;
+}
+
+bool read_interface(CodeUnit* code_unit, String data) {
+    struct Reader reader = { .cursor = data.text, .end = data.text + data.size };
+
+    if (read_u32(&reader) != INTERFACE_MAGIC) {
+        return false;
+    }
+
+    reader.lexer = new_interface_lexer(&data, &code_unit->file_name);
+
+    Scope* scope = new_scope();
+    u32 count = read_u32(&reader);
+
+    for (u32 i = 0; i < count && !reader.failed; i++) {
+        Declaration* declaration = read_declaration(&reader, scope);
+
+        if (!reader.failed) {
+            add_declaration(scope, declaration);
+        }
+    }
+
+    finish_interface_lexer(reader.lexer);
+
+    if (reader.failed || reader.cursor != reader.end) {
+        return false;
+    }
+
+    code_unit->global_scope = scope;
+    return true;
+}
@@ -0,0 +1,200 @@
+// Copyright (C) strawberryhacker.
+//
+// This file contains the identifier intern table. The lexer interns every identifier once, and
+// the rest of the compiler compares names by their symbol ID instead of comparing the text.
+//
+// The table is an open addressing hash table which stores the hash and the symbol ID of each
+// name. The names are stored in separate chunks indexed by the symbol ID.
+//
+// Files are lexed on several threads, so the table is protected by a lock. Every thread keeps a 
+// small direct mapped cache in front of it, which catches most of the repeated identifiers in a
+// file without taking the lock. The name chunks are never moved, so a symbol can be looked up 
+// without the lock once it has been handed out.
+
+#include <intern.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define INITIAL_TABLE_SIZE 1024
+
+#define NAME_CHUNK_SIZE  4096
+#define MAX_NAME_CHUNKS  16384
+
+#define THREAD_CACHE_SIZE 512
+
+struct Entry {
+    u32 hash;
+    u32 symbol;
+};
+
+static struct Entry* table;
+static u32 table_size;
+
+static String* name_chunks[MAX_NAME_CHUNKS];
+// Symbol zero is reserved.
+static u32 name_count = 1;
+
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local struct Entry thread_cache[THREAD_CACHE_SIZE];
+
+static inline String* get_name(u32 symbol) {
+    return &name_chunks[symbol / NAME_CHUNK_SIZE][symbol % NAME_CHUNK_SIZE];
+}
+
+static u32 hash_string(String* name) {
+    // FNV-1a.
+    u32 hash = 2166136261u;
+    for (u32 i = 0; i < name->size; i++) {
+        hash ^= (u8)name->text[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static bool is_same_name(String* a, String* b) {
+    if (a->size != b->size) {
+        return false;
+    }
+
+    for (u32 i = 0; i < a->size; i++) {
+        if (a->text[i] != b->text[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void insert_entry(struct Entry* entries, u32 size, u32 hash, u32 symbol) {
+    u32 mask  = size - 1;
+    u32 index = hash & mask;
+
+    while (entries[index].symbol != SYMBOL_NONE) {
+        index = (index + 1) & mask;
+    }
+
+    entries[index].hash   = hash;
+    entries[index].symbol = symbol;
+}
+
+static void grow_table() {
+    u32 new_size = (table_size) ? table_size * 2 : INITIAL_TABLE_SIZE;
+    struct Entry* entries = calloc(new_size, sizeof(struct Entry));
+
+    if (entries == 0) {
+        printf("Intern : calloc failed\n");
+        exit(1);
+    }
+
+    for (u32 i = 0; i < table_size; i++) {
+        if (table[i].symbol != SYMBOL_NONE) {
+            insert_entry(entries, new_size, table[i].hash, table[i].symbol);
+        }
+    }
+
+    free(table);
+    table      = entries;
+    table_size = new_size;
+}
+
+static u32 add_name(String* name) {
+    u32 chunk = name_count / NAME_CHUNK_SIZE;
+    if (chunk == MAX_NAME_CHUNKS) {
+        printf("Intern : too many symbols\n");
+        exit(1);
+    }
+
+    if (name_chunks[chunk] == 0) {
+        name_chunks[chunk] = malloc(NAME_CHUNK_SIZE * sizeof(String));
+
+        if (name_chunks[chunk] == 0) {
+            printf("Intern : malloc failed\n");
+            exit(1);
+        }
+    }
+
+    u32 symbol = name_count;
+    *get_name(symbol) = *name;
+
+    // Readers check the symbol against the count without taking the lock.
+    __atomic_store_n(&name_count, symbol + 1, __ATOMIC_RELEASE);
+    return symbol;
+}
+
+static u32 lookup_or_insert(String* name, u32 hash) {
+    // Keep the load factor below one half.
+    if (2 * (name_count + 1) >= table_size) {
+        grow_table();
+    }
+
+    u32 mask  = table_size - 1;
+    u32 index = hash & mask;
+
+    while (table[index].symbol != SYMBOL_NONE) {
+        if (table[index].hash == hash && is_same_name(get_name(table[index].symbol), name)) {
+            return table[index].symbol;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    u32 symbol = add_name(name);
+
+    table[index].hash   = hash;
+    table[index].symbol = symbol;
+
+    return symbol;
+}
+
+u32 intern_string(String* name) {
+    u32 hash = hash_string(name);
+
+    struct Entry* cached = &thread_cache[hash & (THREAD_CACHE_SIZE - 1)];
+    if (cached->symbol != SYMBOL_NONE && cached->hash == hash && is_same_name(get_name(cached->symbol), name)) {
+        return cached->symbol;
+    }
+
+    pthread_mutex_lock(&intern_lock);
+    u32 symbol = lookup_or_insert(name, hash);
+    pthread_mutex_unlock(&intern_lock);
+
+    cached->hash   = hash;
+    cached->symbol = symbol;
+
+    return symbol;
+}
+
+String* get_symbol_name(u32 symbol) {
+    if (symbol == SYMBOL_NONE || symbol >= __atomic_load_n(&name_count, __ATOMIC_ACQUIRE)) {
+        printf("Intern : symbol %d is not interned\n", symbol);
+        exit(1);
+    }
+
+    return get_name(symbol);
+}
+
+u32 get_symbol_count() {
+    pthread_mutex_lock(&intern_lock);
+    u32 count = name_count;
+    pthread_mutex_unlock(&intern_lock);
+
+    return count;
+}
+
+void release_intern_table() {
+    pthread_mutex_lock(&intern_lock);
+
+    free(table);
+    table      = 0;
+    table_size = 0;
+    name_count = 1;
+
+    // The name chunks are kept for the next names. Only the cache of this thread can still refer
+    // to the old symbols, since the other threads must be gone.
+    for (u32 i = 0; i < THREAD_CACHE_SIZE; i++) {
+        thread_cache[i] = (struct Entry){ 0 };
+    }
+
+    pthread_mutex_unlock(&intern_lock);
+}
@@ -5,13 +5,35 @@
 // get a token kind, which is a numerical value, such that we quickly can compare the token in the
 // parser. If the token is a number we also assign the number value to the token.
 //
-// The lexer does not tokenize the entire file first. Instead the parser will instruct the lexer
-// to parse tokens on-the-fly. Parsing and lexing is really just the same step.
+// The entire file is lexed up front, before the parser starts. The tokens are stored as a structure
+// of arrays, and the parser only moves an index back and forth over them. Tokens are referred to
+// by a global index, so the tree can keep a token in a u32 instead of copying it.
 
 #include <lexer.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <error.h>
+#include <intern.h>
+#include <scan.h>
+#include <arena.h>
+#include <pthread.h>
+
+Lexer* token_pages[TOKEN_PAGE_COUNT];
+
+// Page zero is reserved, such that no token gets index zero.
+static u32 token_page_count = 1;
+
+// Errors can be reported from any thread, and the line start table is built on first use.
+static pthread_mutex_t location_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// A token while it is being lexed, before it is added to the token arrays.
+struct LexedToken {
+    TokenKind kind;
+    KeywordKind keyword;
+    String name;
+    u32 symbol;
+    u64 number;
+};
 
 static const char* token_kind[] = {
     "none",
@@ -51,27 +73,94 @@ static const char* token_kind[] = {
 };
 
 static const char* keywords[] = {
-    "func",
-    "asm",
-    "u64",
-    "u32",
-    "u16",
-    "u8",
-    "s64",
-    "s32",
-    "s16",
-    "s8",
-    "char",
-    "return",
-    "for",
-    "while",
-    "if",
-    "else",
-    "in",
-    "struct",
-    "union",
+    [KEYWORD_NONE]   = "",
+    [KEYWORD_FUNC]   = "func",
+    [KEYWORD_ASM]    = "asm",
+    [KEYWORD_U64]    = "u64",
+    [KEYWORD_U32]    = "u32",
+    [KEYWORD_U16]    = "u16",
+    [KEYWORD_U8]     = "u8",
+    [KEYWORD_S64]    = "s64",
+    [KEYWORD_S32]    = "s32",
+    [KEYWORD_S16]    = "s16",
+    [KEYWORD_S8]     = "s8",
+    [KEYWORD_CHAR]   = "char",
+    [KEYWORD_RETURN] = "return",
+    [KEYWORD_FOR]    = "for",
+    [KEYWORD_WHILE]  = "while",
+    [KEYWORD_IF]     = "if",
+    [KEYWORD_ELSE]   = "else",
+    [KEYWORD_IN]     = "in",
+    [KEYWORD_STRUCT] = "struct",
+    [KEYWORD_UNION]  = "union",
 };
 
+// Identifiers are classified as keywords using a perfect hash over the first character, the last 
+// character and the length. The table is built from the keyword strings above the first time a 
+// lexer is made, so the strings are the only place a keyword is spelled out. C does not allow 
+// indexing a string literal in a constant expression, so this can not be done by the compiler. 
+// When adding a keyword, the hash must stay collision free - adjust the multiplier if it is not.
+#define KEYWORD_TABLE_SIZE 32
+
+#define KEYWORD_HASH(first, last, size) \
+    (((u32)(first) + 5 * (u32)(last) + (u32)(size)) & (KEYWORD_TABLE_SIZE - 1))
+
+static u8 keyword_table[KEYWORD_TABLE_SIZE];
+static u32 keyword_min_size = ~0u;
+static u32 keyword_max_size;
+
+static pthread_once_t keyword_table_once = PTHREAD_ONCE_INIT;
+
+static void build_keyword_table() {
+    for (u32 kind = KEYWORD_NONE + 1; kind < KEYWORD_KIND_COUNT; kind++) {
+        const char* keyword = keywords[kind];
+
+        u32 size = 0;
+        while (keyword[size]) {
+            size++;
+        }
+
+        u32 slot = KEYWORD_HASH(keyword[0], keyword[size - 1], size);
+        if (keyword_table[slot] != KEYWORD_NONE) {
+            printf("Lexer : the keywords %s and %s have the same hash\n", keywords[keyword_table[slot]], keyword);
+            exit(1);
+        }
+
+        keyword_table[slot] = kind;
+
+        if (size < keyword_min_size) {
+            keyword_min_size = size;
+        }
+
+        if (size > keyword_max_size) {
+            keyword_max_size = size;
+        }
+    }
+}
+
+static KeywordKind classify_keyword(String* name) {
+    if (name->size < keyword_min_size || name->size > keyword_max_size) {
+        return KEYWORD_NONE;
+    }
+
+    const char* text = name->text;
+    KeywordKind kind = keyword_table[KEYWORD_HASH(text[0], text[name->size - 1], name->size)];
+
+    // Only one keyword can land in each slot, so a single compare confirms the match.
+    const char* keyword = keywords[kind];
+    for (u32 i = 0; i < name->size; i++) {
+        if (keyword[i] != text[i]) {
+            return KEYWORD_NONE;
+        }
+    }
+
+    if (keyword[name->size]) {
+        return KEYWORD_NONE;
+    }
+
+    return kind;
+}
+
 static bool is_whitespace(char c) {
     return c == '\n' || c == '\r' || c == '\t' || c == ' ';
 }
@@ -95,29 +184,14 @@ static bool is_valid_letter(char c) {
     return false;
 }
 
+// Tokens only store their byte offset. Lines and columns are worked out from the offset when an 
+// error is reported, so the lexer does not have to track them.
 static char advance_lexer(Lexer* lexer) {
-    char c = lexer->cursor[0];
-    if (c == 0) {
+    if (lexer->cursor[0] == 0) {
         return '\0';
     }
 
     lexer->cursor++;
-    if (c == '\r') {
-        if (lexer->cursor[0] == '\n') {
-            lexer->cursor++;
-        }
-
-        c = '\n';
-    }
-
-    if (c == '\n') {
-        lexer->line++;
-        lexer->column = 0;
-    }
-    else {
-        lexer->column++;
-    }
-
     return lexer->cursor[0];
 }
 
@@ -127,23 +201,31 @@ static void advance_lexer_with(Lexer* lexer, u32 count) {
     }
 }
 
+// End of the source buffer, the block scanners must not read past this.
+static const char* get_lexer_end(Lexer* lexer) {
+    return lexer->file.text + lexer->file.size;
+}
+
 static void skip_whitespaces(Lexer* lexer) {
+    // The block scan skips the bulk of a whitespace run, and the loop below is the reference 
+    // implementation which handles whatever is left.
+    lexer->cursor += scan_whitespace(lexer->cursor, get_lexer_end(lexer));
+
     while (is_whitespace(lexer->cursor[0]) && lexer->cursor[0]) {
         advance_lexer(lexer);
     }
 }
 
-static void skip_punctuation(Lexer* lexer, u32 skip_count, Token* token, TokenKind kind) {
+static void skip_punctuation(Lexer* lexer, u32 skip_count, struct LexedToken* token, TokenKind kind) {
     token->name.text = lexer->cursor;
     token->name.size = skip_count;
     token->kind      = kind;
 
     // This works because we have checked the chars to skip in the punctuation parser.
     lexer->cursor += skip_count;
-    lexer->column += skip_count;
 }
 
-static void parse_puctuation(Lexer* lexer, Token* token) {
+static void parse_puctuation(Lexer* lexer, struct LexedToken* token) {
     char current = lexer->cursor[0];
     char next    = lexer->cursor[1];
 
@@ -290,7 +372,7 @@ static s8 char_to_number(char c) {
     return -1;
 }
 
-static void parse_number(Lexer* lexer, Token* token) {
+static void parse_number(Lexer* lexer, struct LexedToken* token) {
     u32 base = 10;
     token->name.text = lexer->cursor;
 
@@ -341,19 +423,23 @@ static void parse_number(Lexer* lexer, Token* token) {
     token->kind      = TOKEN_NUMBER;
 }
 
-static void parse_identifier(Lexer* lexer, Token* token) {
+static void parse_identifier(Lexer* lexer, struct LexedToken* token) {
     token->name.text = lexer->cursor;
 
+    lexer->cursor += scan_identifier(lexer->cursor, get_lexer_end(lexer));
+
     char c = lexer->cursor[0];
     while (is_number(c) || is_valid_letter(c)) {
         c = advance_lexer(lexer);
     }
 
     token->name.size = lexer->cursor - token->name.text;
+    token->symbol    = intern_string(&token->name);
+    token->keyword   = classify_keyword(&token->name);
     token->kind      = TOKEN_IDENTIFIER;
 }
 
-static void parse_comment(Lexer* lexer, Token* token) {
+static void parse_comment(Lexer* lexer, struct LexedToken* token) {
     // We allready know that the two first characters are correct. 
     advance_lexer_with(lexer, 2);
 
@@ -365,6 +451,14 @@ static void parse_comment(Lexer* lexer, Token* token) {
         u32 nesting_level = 1;
        
         while (1) {
+            // Skip straight to the next slash.
+            lexer->cursor += scan_until(lexer->cursor, get_lexer_end(lexer), '/', '/', 0);
+
+            if (lexer->cursor[0] == 0) {
+                printf("Lexer : unterminated comment.\n");
+                exit(1);
+            }
+
             if (lexer->cursor[0] == '/' && lexer->cursor[1] == '/') {
                 char c = lexer->cursor[2];
                 
@@ -385,7 +479,9 @@ static void parse_comment(Lexer* lexer, Token* token) {
         }
     }
     else {
-        while (lexer->cursor[0] != '\r' && lexer->cursor[0] != '\n') {
+        lexer->cursor += scan_until(lexer->cursor, get_lexer_end(lexer), '\r', '\n', 0);
+
+        while (lexer->cursor[0] != '\r' && lexer->cursor[0] != '\n' && lexer->cursor[0]) {
             advance_lexer(lexer);
         }
     }
@@ -394,12 +490,14 @@ static void parse_comment(Lexer* lexer, Token* token) {
     token->kind      = TOKEN_COMMENT;
 }
 
-static void parse_string(Lexer* lexer, Token* token) {
+static void parse_string(Lexer* lexer, struct LexedToken* token) {
     advance_lexer(lexer);
 
     // We save the token without including the quotes.
     token->name.text = lexer->cursor;
 
+    lexer->cursor += scan_until(lexer->cursor, get_lexer_end(lexer), '"', '"', 0);
+
     while (lexer->cursor[0] != '"' && lexer->cursor[0]) {
         advance_lexer(lexer);
     }
@@ -415,14 +513,15 @@ static void parse_string(Lexer* lexer, Token* token) {
     advance_lexer(lexer);
 }
 
-static void process_next_token(Lexer* lexer, Token* token) {
-    assert(token->lexer);
-    token->kind = TOKEN_NONE;
+static void process_next_token(Lexer* lexer, struct LexedToken* token) {
+    token->kind    = TOKEN_NONE;
+    token->symbol  = SYMBOL_NONE;
+    token->keyword = KEYWORD_NONE;
 
     skip_whitespaces(lexer);
 
-    token->line   = lexer->line;
-    token->column = lexer->column;
+    token->name.text = lexer->cursor;
+    token->name.size = 0;
 
     char c = lexer->cursor[0];
     if (c == 0) {
@@ -452,10 +551,112 @@ static void process_next_token(Lexer* lexer, Token* token) {
     }
 }
 
+static void* grow_array(void* array, u32 capacity, u32 element_size) {
+    array = realloc(array, (u64)capacity * element_size);
+
+    if (array == 0) {
+        printf("Lexer : realloc failed\n");
+        exit(1);
+    }
+
+    return array;
+}
+
+static void add_token(Lexer* lexer, struct LexedToken* token) {
+    if (lexer->token_count == lexer->token_capacity) {
+        u32 capacity = (lexer->token_capacity) ? lexer->token_capacity * 2 : 1024;
+
+        lexer->kinds    = grow_array(lexer->kinds,    capacity, sizeof(u8));
+        lexer->keywords = grow_array(lexer->keywords, capacity, sizeof(u8));
+        lexer->offsets  = grow_array(lexer->offsets,  capacity, sizeof(u32));
+        lexer->sizes    = grow_array(lexer->sizes,    capacity, sizeof(u32));
+        lexer->values   = grow_array(lexer->values,   capacity, sizeof(u32));
+
+        lexer->token_capacity = capacity;
+    }
+
+    u32 value = token->symbol;
+
+    if (token->kind == TOKEN_NUMBER) {
+        if (lexer->number_count == lexer->number_capacity) {
+            lexer->number_capacity = (lexer->number_capacity) ? lexer->number_capacity * 2 : 256;
+            lexer->numbers = grow_array(lexer->numbers, lexer->number_capacity, sizeof(u64));
+        }
+
+        value = lexer->number_count++;
+        lexer->numbers[value] = token->number;
+    }
+
+    u32 position = lexer->token_count++;
+
+    lexer->kinds[position]    = token->kind;
+    lexer->keywords[position] = token->keyword;
+    lexer->offsets[position]  = token->name.text - lexer->file.text;
+    lexer->sizes[position]    = token->name.size;
+    lexer->values[position]   = value;
+}
+
+// Claims enough pages of token indices for 'count' tokens.
+static void claim_token_pages(Lexer* lexer, u64 count) {
+    u32 page_count = (count + TOKEN_PAGE_SIZE - 1) >> TOKEN_PAGE_BITS;
+    if (page_count == 0) {
+        page_count = 1;
+    }
+
+    u32 first_page = __atomic_fetch_add(&token_page_count, page_count, __ATOMIC_RELAXED);
+
+    if ((u64)first_page + page_count > TOKEN_PAGE_COUNT) {
+        printf("Lexer : the program has too many tokens\n");
+        exit(1);
+    }
+
+    for (u32 i = 0; i < page_count; i++) {
+        token_pages[first_page + i] = lexer;
+    }
+
+    lexer->first_token = first_page << TOKEN_PAGE_BITS;
+}
+
+void release_token_pages() {
+    for (u32 i = 0; i < token_page_count; i++) {
+        token_pages[i] = 0;
+    }
+
+    token_page_count = 1;
+}
+
+// Moves an array from the heap into the current arena, with no spare capacity.
+static void* move_array(void* array, u32 count, u32 element_size) {
+    void* copy = phase_allocate(ALLOCATION_TOKEN, (u64)count * element_size);
+
+    if (count) {
+        __builtin_memcpy(copy, array, (u64)count * element_size);
+    }
+
+    free(array);
+    return copy;
+}
+
+// The token arrays are only grown while lexing. Afterwards they live in the arena like the tree 
+// which refers to them.
+static void move_tokens_to_arena(Lexer* lexer) {
+    lexer->kinds    = move_array(lexer->kinds,    lexer->token_count, sizeof(u8));
+    lexer->keywords = move_array(lexer->keywords, lexer->token_count, sizeof(u8));
+    lexer->offsets  = move_array(lexer->offsets,  lexer->token_count, sizeof(u32));
+    lexer->sizes    = move_array(lexer->sizes,    lexer->token_count, sizeof(u32));
+    lexer->values   = move_array(lexer->values,   lexer->token_count, sizeof(u32));
+    lexer->numbers  = move_array(lexer->numbers,  lexer->number_count, sizeof(u64));
+
+    lexer->token_capacity  = lexer->token_count;
+    lexer->number_capacity = lexer->number_count;
+}
+
 Lexer* new_lexer(String* file, String* file_name) {
     assert(file->text[file->size - 1] == 0);
-    
-    Lexer* lexer = calloc(1, sizeof(Lexer));
+
+    pthread_once(&keyword_table_once, build_keyword_table);
+
+    Lexer* lexer = phase_allocate(ALLOCATION_TOKEN, sizeof(Lexer));
 
     lexer->file.size = file->size;
     lexer->file.text = file->text;
@@ -464,154 +665,183 @@ Lexer* new_lexer(String* file, String* file_name) {
     lexer->file_name.text = file_name->text;
 
     lexer->cursor = file->text;
-    lexer->column = 0;
-    lexer->line   = 1;
 
-    for (u32 i = 0; i < TOKEN_BUFFER_SIZE; i++) {
-        lexer->tokens[i].token.lexer = lexer;
-        lexer->tokens[i].is_valid    = false;
-    }
+    // The file always ends with an end of file token, which the parser can not move past.
+    struct LexedToken token;
 
-    lexer->current_index = 0;
-    lexer->buffer_index  = 0;
+    do {
+        process_next_token(lexer, &token);
+        add_token(lexer, &token);
+    } while (token.kind != TOKEN_END_OF_FILE);
 
+    move_tokens_to_arena(lexer);
+    claim_token_pages(lexer, lexer->token_count);
+
+    lexer->current = 0;
     return lexer;
 }
 
-static void increment_index(u32* index) {
-    *index += 1;
-    if (*index == TOKEN_BUFFER_SIZE) {
-        *index = 0;
-    }
+Lexer* new_interface_lexer(String* data, String* file_name) {
+    Lexer* lexer = phase_allocate(ALLOCATION_TOKEN, sizeof(Lexer));
+
+    lexer->file         = *data;
+    lexer->file_name    = *file_name;
+    lexer->is_interface = true;
+
+    // The tokens are handed out while the names are added. Every name takes up at least its size 
+    // in the data, so this is enough pages for all of them.
+    claim_token_pages(lexer, (u64)data->size + 1);
+    return lexer;
 }
 
-static u32 get_undo_distance(Lexer* lexer) {
-    if (lexer->current_index >= lexer->buffer_index) {
-        return lexer->current_index - lexer->buffer_index;
+u32 add_interface_token(Lexer* lexer, String name) {
+    struct LexedToken token = { .kind = TOKEN_IDENTIFIER, .name = name };
+
+    if (name.size) {
+        assert(name.text >= lexer->file.text && name.text + name.size <= lexer->file.text + lexer->file.size);
+        token.symbol = intern_string(&name);
     }
     else {
-        return lexer->current_index + TOKEN_BUFFER_SIZE - lexer->buffer_index;
+        token.name.text = lexer->file.text;
     }
+
+    add_token(lexer, &token);
+    return lexer->first_token + lexer->token_count - 1;
 }
 
-Token* next_token(Lexer* lexer) {
-    if (get_undo_distance(lexer) > TOKEN_UNDO_COUNT) {
-        lexer->tokens[lexer->buffer_index].is_valid = false;
-        increment_index(&lexer->buffer_index);
-    }
+void finish_interface_lexer(Lexer* lexer) {
+    move_tokens_to_arena(lexer);
+}
+
+static void build_line_starts(Lexer* lexer) {
+    // The size includes the zero terminator, which the line break scanner may look at.
+    const char* text = lexer->file.text;
+    u32 size = lexer->file.size - 1;
 
-    increment_index(&lexer->current_index);
+    u32 break_count = find_line_breaks(text, size, 0);
+    u32* starts = phase_allocate(ALLOCATION_TOKEN, (break_count + 1) * sizeof(u32));
 
-    Token* token = &lexer->tokens[lexer->current_index].token;
-    if (lexer->tokens[lexer->current_index].is_valid == false) {
-        lexer->tokens[lexer->current_index].is_valid = true;
-        process_next_token(lexer, token);
+    // Every line starts right after a line break, and the first line at the start of the file.
+    find_line_breaks(text, size, starts + 1);
+    for (u32 i = 1; i <= break_count; i++) {
+        starts[i]++;
     }
 
-    return token;
+    lexer->line_count  = break_count + 1;
+    lexer->line_starts = starts;
 }
 
-Token* peek_token(Lexer* lexer, u32 count) {
-    if (count > TOKEN_PEEK_COUNT) {
-        printf("Lexer : peek count exceeded - are you sure you need to peek %d tokens?\n", count);
-        exit(1);
+void get_token_location(u32 token, u32* line, u32* column) {
+    Lexer* lexer = get_token_lexer(token);
+    u32 offset = lexer->offsets[get_token_position(lexer, token)];
+
+    pthread_mutex_lock(&location_lock);
+    if (lexer->line_starts == 0) {
+        build_line_starts(lexer);
     }
+    pthread_mutex_unlock(&location_lock);
 
-    u32 index = lexer->current_index;
-    for (u32 i = 0; i < count; i++) {
-        increment_index(&index);
+    // Finds the last line starting at or before the token.
+    u32 low  = 0;
+    u32 high = lexer->line_count;
 
-        if (lexer->tokens[index].is_valid == false) {
-            lexer->tokens[index].is_valid = true;
-            process_next_token(lexer, &lexer->tokens[index].token);
+    while (high - low > 1) {
+        u32 middle = low + (high - low) / 2;
+
+        if (lexer->line_starts[middle] <= offset) {
+            low = middle;
+        }
+        else {
+            high = middle;
         }
     }
 
-    return &lexer->tokens[index].token;
+    *line   = low + 1;
+    *column = offset - lexer->line_starts[low];
 }
 
-Token* undo_next_token(Lexer* lexer) {
-    if (get_undo_distance(lexer) > 1) {
-        if (lexer->current_index) {
-            lexer->current_index -= 1;
-        }
-        else {
-            lexer->current_index = TOKEN_BUFFER_SIZE - 1;
-        }
+static inline u32 get_current_index(Lexer* lexer) {
+    return lexer->first_token + lexer->current;
+}
 
-        assert(lexer->tokens[lexer->current_index].is_valid == true);
-        return &lexer->tokens[lexer->current_index].token;
+u32 next_token(Lexer* lexer) {
+    if (lexer->current + 1 < lexer->token_count) {
+        lexer->current++;
     }
 
-    exit(21);
+    return get_current_index(lexer);
 }
 
-Token* peek_next(Lexer* lexer) {
-    return peek_token(lexer, 1);
+u32 peek_token(Lexer* lexer, u32 count) {
+    u32 position = lexer->current + count;
+
+    if (position >= lexer->token_count) {
+        position = lexer->token_count - 1;
+    }
+
+    return lexer->first_token + position;
 }
 
-Token* current_token(Lexer* lexer) {
-    assert(lexer->current_index != lexer->buffer_index);
-    return peek_token(lexer, 0);
+u32 undo_next_token(Lexer* lexer) {
+    assert(lexer->current);
+
+    lexer->current--;
+    return get_current_index(lexer);
 }
 
-Token* consume_token(Lexer* lexer) {
-    Token* token = current_token(lexer);
-    next_token(lexer);
-    return token;
+void seek_token(Lexer* lexer, u32 token) {
+    assert(token >= lexer->first_token && token - lexer->first_token < lexer->token_count);
+    lexer->current = token - lexer->first_token;
 }
 
-Token* expect_token(Lexer* lexer, TokenKind kind) {
-    Token* token = next_token(lexer);
-    if (token->kind != kind) {
-        assert(token->kind < TOKEN_KIND_COUNT);
-        assert(kind < TOKEN_KIND_COUNT);
+u32 peek_next(Lexer* lexer) {
+    return peek_token(lexer, 1);
+}
 
-        error_token(token, "Expecting %s but got %s", token_kind[kind], token_kind[token->kind]);
-    }
+u32 current_token(Lexer* lexer) {
+    return get_current_index(lexer);
+}
 
+u32 consume_token(Lexer* lexer) {
+    u32 token = current_token(lexer);
+    next_token(lexer);
     return token;
 }
 
-Token* skip_token(Lexer* lexer, TokenKind kind) {
-    Token* token = current_token(lexer);
-    if (token->kind != kind) {
-        assert(token->kind < TOKEN_KIND_COUNT);
+u32 expect_token(Lexer* lexer, TokenKind kind) {
+    u32 token = next_token(lexer);
+    TokenKind actual = get_token_kind(token);
+
+    if (actual != kind) {
+        assert(actual < TOKEN_KIND_COUNT);
         assert(kind < TOKEN_KIND_COUNT);
 
-        error_token(token, "Expecting %s but got %s", token_kind[kind], token_kind[token->kind]);
+        error_token(token, "Expecting %s but got %s", token_kind[kind], token_kind[actual]);
     }
 
-    return next_token(lexer);
+    return token;
 }
 
-bool is_keyword(Token* token, KeywordKind kind) {
-    if (kind >= KEYWORD_KIND_COUNT) {
-        printf("Lexer : keyword kind %d not handled.\n", kind);
-        exit(1);
-    }
-
-    const char* a = token->name.text;
-    const char* b = keywords[kind];
+u32 skip_token(Lexer* lexer, TokenKind kind) {
+    u32 token = current_token(lexer);
+    TokenKind actual = get_token_kind(token);
 
-    for (u32 i = 0; i < token->name.size; i++, a++, b++) {
-        if (*b == 0 || *a != *b) {
-            return false;
-        }
-    }
+    if (actual != kind) {
+        assert(actual < TOKEN_KIND_COUNT);
+        assert(kind < TOKEN_KIND_COUNT);
 
-    if (*b) {
-        return false;
+        error_token(token, "Expecting %s but got %s", token_kind[kind], token_kind[actual]);
     }
 
-    return true;
+    return next_token(lexer);
 }
 
-Token* skip_keyword(Lexer* lexer, KeywordKind kind) {
-    Token* token = current_token(lexer);
+u32 skip_keyword(Lexer* lexer, KeywordKind kind) {
+    u32 token = current_token(lexer);
 
     if (!is_keyword(token, kind)) {
-        error_token(token, "Expected the keyword '%s', but got %.*s\n", keywords[kind], token->name.size, token->name.text);
+        String name = get_token_name(token);
+        error_token(token, "Expected the keyword '%s', but got %.*s\n", keywords[kind], name.size, name.text);
     }
 
     return next_token(lexer);
@@ -1,72 +1,32 @@
 #include <stdio.h>
-#include <assert.h>
-#include <string.h>
 #include <stdlib.h>
 #include <lexer.h>
-#include <parser.h>
-#include <tree_printer.h>
-#include <generator.h>
-#include <typer.h>
+#include <compile.h>
+#include <server.h>
 
-void read_source_file(String* string, char* file_name) {
-    File* file = fopen(file_name, "r");
-    if (!file) {
-        exit(1);
-    }
-
-    printf("size of file is : %ld\n", sizeof(File));
-    
-    fseek(file, 0, SEEK_END);
-    u32 file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    string->size = file_size + 1;
-    string->text = malloc(string->size);
-
-    assert(fread(string->text, 1, file_size, file) == file_size);
-    string->text[file_size] = 0;
-}
-
-void print_token(Token* token) {
-    printf("%.*s\n", token->name.size, token->name.text);
-}
-
-static u32 string_length(const char* data) {
-    u32 length = 0;
-    while (*data++) {
-        length++;
-    }
-
-    return length;
+void print_token(u32 token) {
+    String name = get_token_name(token);
+    printf("%.*s\n", name.size, name.text);
 }
 
 int main(int argument_count, char** arguments) {
-    assert(argument_count == 3);
-
-    printf("Input file  : %s\n", arguments[1]);
-    printf("Output file : %s\n", arguments[2]);
-
-    String source_file;
-    String source_file_name = (String){ .text = arguments[1], .size = string_length(arguments[1]) };
+    // Skip the program name.
+    arguments++;
+    argument_count--;
 
-    // We read the entire source file into memory.
-    read_source_file(&source_file, arguments[1]);
-
-    Lexer* lexer   = new_lexer(&source_file, &source_file_name);
-    Parser* parser = new_parser(lexer);
-    Typer typer;
-    
-    // Build the syntax tree.
-    Program* program = parser_program(parser);
-    print_program(program);
+    if (argument_count == 2 && is_option(arguments[0], "--serve")) {
+        run_server(arguments[1]);
+    }
 
-    printf("Typing starting\n");
+    if (argument_count >= 2 && is_option(arguments[0], "--connect")) {
+        run_client(arguments[1], argument_count - 2, arguments + 2);
+    }
 
-    // Type the syntax tree.
-    type_program(program, &typer);
-    print_program(program);
+    Options options;
+    if (!parse_options(&options, argument_count, arguments)) {
+        print_usage();
+        exit(1);
+    }
 
-    // Generate the output file from the typed syntax tree.
-    generator_init(arguments[2]);
-    generate_program(program);
-}
\ No newline at end of file
+    compile(&options, 0);
+}
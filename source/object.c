@@ -0,0 +1,702 @@
+// Copyright (C) strawberryhacker.
+//
+// This file writes the object fragments of the code units, and lays them out into an ELF64
+// relocatable object, or links them with the runtime into a static ELF64 executable. A fragment is
+// a list of entries:
+//
+//   entry      : section, is_global, name, size, data, relocation count, relocation...
+//   relocation : offset, kind, addend, name
+//   name       : size, text
+//
+// BSS entries have no data. Like the interface format the numbers are in host byte order, which
+// is also the byte order of the object file.
+
+#include <object.h>
+#include <intern.h>
+#include <table.h>
+#include <arena.h>
+#include <string.h>
+#include <assembler.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define ELF_HEADER_SIZE     64
+#define PROGRAM_HEADER_SIZE 56
+#define SECTION_HEADER_SIZE 64
+#define SYMBOL_SIZE         24
+#define RELA_SIZE           24
+
+#define ET_REL  1
+#define ET_EXEC 2
+
+#define PT_LOAD      1
+#define PT_GNU_STACK 0x6474e551
+
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
+
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB   2
+#define SHT_STRTAB   3
+#define SHT_RELA     4
+#define SHT_NOBITS   8
+
+#define SHF_WRITE      0x1
+#define SHF_ALLOC      0x2
+#define SHF_EXECINSTR  0x4
+#define SHF_INFO_LINK  0x40
+
+#define STB_LOCAL  0
+#define STB_GLOBAL 1
+
+#define STT_NOTYPE 0
+#define STT_OBJECT 1
+#define STT_FUNC   2
+
+#define R_X86_64_PC32  2
+#define R_X86_64_PLT32 4
+
+// Executables are loaded at the usual address for non-PIE x86-64 programs. There are two loadable
+// segments, code and data, plus the segment which marks the stack as not executable.
+#define EXECUTABLE_BASE          0x400000
+#define EXECUTABLE_SEGMENT_COUNT 3
+#define PAGE_SIZE                0x1000
+
+#define align_up(value, alignment) (((value) + (alignment) - 1) & ~(u64)((alignment) - 1))
+
+// Section header indices of the object.
+enum {
+    SECTION_NULL,
+    SECTION_TEXT,
+    SECTION_DATA,
+    SECTION_BSS,
+    SECTION_RELA_TEXT,
+    SECTION_NOTE_GNU_STACK,
+    SECTION_SYMTAB,
+    SECTION_STRTAB,
+    SECTION_SHSTRTAB,
+    SECTION_COUNT
+};
+
+// Functions are aligned to 16 bytes like gcc does it, and global variables to 8 bytes.
+static const u32 section_alignments[OBJECT_SECTION_COUNT] = { 16, 1, 8 };
+static const u16 section_indices[OBJECT_SECTION_COUNT] = { SECTION_TEXT, SECTION_DATA, SECTION_BSS };
+static const u32 relocation_types[] = { [RELOCATION_PC32] = R_X86_64_PC32, [RELOCATION_PLT32] = R_X86_64_PLT32 };
+
+static void write_u8(OutputBuffer* buffer, u8 value) {
+    output_add(buffer, (const char *)&value, 1);
+}
+
+static void write_u16(OutputBuffer* buffer, u16 value) {
+    output_add(buffer, (const char *)&value, 2);
+}
+
+static void write_u32(OutputBuffer* buffer, u32 value) {
+    output_add(buffer, (const char *)&value, 4);
+}
+
+static void write_u64(OutputBuffer* buffer, u64 value) {
+    output_add(buffer, (const char *)&value, 8);
+}
+
+static void write_name(OutputBuffer* buffer, String name) {
+    write_u32(buffer, name.size);
+    output_add(buffer, name.text, name.size);
+}
+
+static void write_padding(OutputBuffer* buffer, u32 alignment, u8 value) {
+    while (buffer->size % alignment) {
+        write_u8(buffer, value);
+    }
+}
+
+void write_object_symbol(OutputBuffer* fragment, ObjectSection section, bool is_global, String name, const u8* data, u32 size, Relocation* relocations, u32 relocation_count) {
+    write_u8(fragment, section);
+    write_u8(fragment, is_global);
+    write_name(fragment, name);
+    write_u32(fragment, size);
+
+    if (section != OBJECT_BSS) {
+        output_add(fragment, (const char *)data, size);
+    }
+
+    write_u32(fragment, relocation_count);
+    for (u32 i = 0; i < relocation_count; i++) {
+        write_u32(fragment, relocations[i].offset);
+        write_u8(fragment, relocations[i].kind);
+        write_u32(fragment, relocations[i].addend);
+        write_name(fragment, relocations[i].symbol);
+    }
+}
+
+struct Reader {
+    const u8* cursor;
+    const u8* end;
+};
+
+static const u8* read_bytes(struct Reader* reader, u32 size) {
+    if ((u64)(reader->end - reader->cursor) < size) {
+        printf("Object : fragment is corrupt\n");
+        exit(1);
+    }
+
+    const u8* bytes = reader->cursor;
+    reader->cursor += size;
+    return bytes;
+}
+
+static u8 read_u8(struct Reader* reader) {
+    return *read_bytes(reader, 1);
+}
+
+static u32 read_u32(struct Reader* reader) {
+    u32 value;
+    __builtin_memcpy(&value, read_bytes(reader, 4), 4);
+    return value;
+}
+
+static String read_name(struct Reader* reader) {
+    String name;
+    name.size = read_u32(reader);
+    name.text = (char *)read_bytes(reader, name.size);
+    return name;
+}
+
+struct ObjectSymbol {
+    String name;
+    u8 binding;
+    u8 type;
+    u16 section;
+    u64 value;
+    u64 size;
+};
+
+struct ObjectRelocation {
+    u64 offset;
+    u32 type;
+    s32 addend;
+    String symbol;
+
+    // Index of the symbol in the symbol table.
+    u32 index;
+};
+
+struct ObjectWriter {
+    OutputBuffer sections[OBJECT_SECTION_COUNT];
+    u64 bss_size;
+
+    // Local symbols are placed before the global ones, as the symbol table requires.
+    struct ObjectSymbol* symbols[2];
+    u32 symbol_counts[2];
+    u32 symbol_capacities[2];
+
+    struct ObjectRelocation* relocations;
+    u32 relocation_count;
+    u32 relocation_capacity;
+};
+
+static void* grow_array(void* array, u32* capacity, u32 count, u32 element_size) {
+    if (count < *capacity) {
+        return array;
+    }
+
+    *capacity = (*capacity) ? 2 * *capacity : 64;
+    array = realloc(array, (u64)*capacity * element_size);
+    if (array == 0) {
+        printf("Object : realloc failed\n");
+        exit(1);
+    }
+
+    return array;
+}
+
+static void add_symbol(struct ObjectWriter* writer, struct ObjectSymbol symbol) {
+    u32 list = (symbol.binding == STB_GLOBAL);
+
+    writer->symbols[list] = grow_array(writer->symbols[list], &writer->symbol_capacities[list], writer->symbol_counts[list], sizeof(struct ObjectSymbol));
+    writer->symbols[list][writer->symbol_counts[list]++] = symbol;
+}
+
+// Copies the fragment into one piece of memory. The names in it are interned, so it is taken
+// from the arena, which lives as long as the symbols.
+static struct Reader flatten_fragment(OutputBuffer* fragment) {
+    u8* data = phase_allocate(ALLOCATION_OTHER, fragment->size);
+    u8* cursor = data;
+
+    for (OutputBlock* block = fragment->first; block; block = block->next) {
+        __builtin_memcpy(cursor, block->data, block->size);
+        cursor += block->size;
+    }
+
+    return (struct Reader){ .cursor = data, .end = data + fragment->size };
+}
+
+static void read_fragment(struct ObjectWriter* writer, OutputBuffer* fragment) {
+    struct Reader reader = flatten_fragment(fragment);
+
+    while (reader.cursor != reader.end) {
+        u8 section = read_u8(&reader);
+        bool is_global = read_u8(&reader);
+        String name = read_name(&reader);
+        u32 size = read_u32(&reader);
+
+        if (section >= OBJECT_SECTION_COUNT) {
+            printf("Object : fragment is corrupt\n");
+            exit(1);
+        }
+
+        u64 offset;
+        if (section == OBJECT_BSS) {
+            writer->bss_size = (writer->bss_size + 7) & ~7ull;
+            offset = writer->bss_size;
+            writer->bss_size += size;
+        }
+        else {
+            OutputBuffer* buffer = &writer->sections[section];
+            write_padding(buffer, section_alignments[section], (section == OBJECT_TEXT) ? 0x90 : 0);
+            offset = buffer->size;
+            output_add(buffer, (const char *)read_bytes(&reader, size), size);
+        }
+
+        add_symbol(writer, (struct ObjectSymbol){
+            .name    = name,
+            .binding = (is_global) ? STB_GLOBAL : STB_LOCAL,
+            .type    = (section == OBJECT_TEXT) ? STT_FUNC : STT_OBJECT,
+            .section = section_indices[section],
+            .value   = offset,
+            .size    = size,
+        });
+
+        u32 relocation_count = read_u32(&reader);
+        for (u32 i = 0; i < relocation_count; i++) {
+            struct ObjectRelocation relocation;
+            relocation.offset = offset + read_u32(&reader);
+            u8 kind           = read_u8(&reader);
+            relocation.addend = read_u32(&reader);
+            relocation.symbol = read_name(&reader);
+
+            // Only code has relocations.
+            if (section != OBJECT_TEXT || kind > RELOCATION_PLT32) {
+                printf("Object : fragment is corrupt\n");
+                exit(1);
+            }
+
+            relocation.type = relocation_types[kind];
+
+            writer->relocations = grow_array(writer->relocations, &writer->relocation_capacity, writer->relocation_count, sizeof(struct ObjectRelocation));
+            writer->relocations[writer->relocation_count++] = relocation;
+        }
+    }
+}
+
+// Numbers the symbols, locals first, and points every relocation at its symbol. Symbols which are
+// referenced but not defined are added as undefined globals. Index zero is the null symbol.
+static void resolve_symbols(struct ObjectWriter* writer) {
+    SymbolTable symbol_indices = { 0 };
+    u32 symbol_count = 1;
+
+    for (u32 list = 0; list < 2; list++) {
+        for (u32 i = 0; i < writer->symbol_counts[list]; i++) {
+            struct ObjectSymbol* symbol = &writer->symbols[list][i];
+            u32 key = intern_string(&symbol->name);
+
+            if (table_lookup(&symbol_indices, key)) {
+                printf("Object : symbol %.*s is defined more than once\n", symbol->name.size, symbol->name.text);
+                exit(1);
+            }
+
+            table_insert(&symbol_indices, key, (void *)(u64)symbol_count++);
+        }
+    }
+
+    for (u32 i = 0; i < writer->relocation_count; i++) {
+        struct ObjectRelocation* relocation = &writer->relocations[i];
+        u32 key = intern_string(&relocation->symbol);
+        u64 index = (u64)table_lookup(&symbol_indices, key);
+
+        if (index == 0) {
+            add_symbol(writer, (struct ObjectSymbol){ .name = relocation->symbol, .binding = STB_GLOBAL });
+            index = symbol_count++;
+            table_insert(&symbol_indices, key, (void *)index);
+        }
+
+        relocation->index = index;
+    }
+}
+
+static struct ObjectSymbol* get_symbol(struct ObjectWriter* writer, u32 index) {
+    assert(index > 0);
+    index--;
+
+    if (index < writer->symbol_counts[0]) {
+        return &writer->symbols[0][index];
+    }
+
+    return &writer->symbols[1][index - writer->symbol_counts[0]];
+}
+
+// Symbol values are the offsets in their sections plus the section addresses, which are zero in an
+// object file.
+static void write_symbol_table(struct ObjectWriter* writer, const u64 addresses[SECTION_BSS + 1], OutputBuffer* symtab, OutputBuffer* strtab) {
+    u32 symbol_count = 1 + writer->symbol_counts[0] + writer->symbol_counts[1];
+
+    write_u8(strtab, 0);
+    output_add(symtab, (const char [SYMBOL_SIZE]){ 0 }, SYMBOL_SIZE);
+
+    for (u32 i = 1; i < symbol_count; i++) {
+        struct ObjectSymbol* symbol = get_symbol(writer, i);
+
+        write_u32(symtab, strtab->size);
+        output_add(strtab, symbol->name.text, symbol->name.size);
+        write_u8(strtab, 0);
+
+        write_u8(symtab, (symbol->binding << 4) | symbol->type);
+        write_u8(symtab, 0);
+        write_u16(symtab, symbol->section);
+        write_u64(symtab, addresses[symbol->section] + symbol->value);
+        write_u64(symtab, symbol->size);
+    }
+}
+
+struct SectionHeader {
+    const char* name;
+    u32 type;
+    u64 flags;
+    u64 address;
+    u32 link;
+    u32 info;
+    u64 alignment;
+    u64 entry_size;
+
+    // Alignment of the contents in the file, if it is stricter than the section alignment.
+    u64 file_alignment;
+
+    // Filled in when the file is laid out.
+    u64 offset;
+    u64 size;
+};
+
+// Lays out the section contents back to back, followed by the section headers. The size of the file
+// buffer must count the headers which are written in front of it, such that it is the file offset.
+// The last section must be the section name table, which is built here.
+static u64 write_sections(OutputBuffer* file, struct SectionHeader* headers, OutputBuffer** contents, u32 count) {
+    OutputBuffer shstrtab;
+    output_init(&shstrtab);
+    u32 name_offsets[SECTION_COUNT];
+
+    assert(count <= SECTION_COUNT && contents[count - 1] == 0);
+    contents[count - 1] = &shstrtab;
+
+    for (u32 i = 0; i < count; i++) {
+        String name = make_string(headers[i].name);
+        name_offsets[i] = shstrtab.size;
+        output_add(&shstrtab, name.text, name.size);
+        write_u8(&shstrtab, 0);
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        if (contents[i] == 0) {
+            headers[i].offset = file->size;
+            continue;
+        }
+
+        u64 alignment = (headers[i].file_alignment) ? headers[i].file_alignment : headers[i].alignment;
+        write_padding(file, alignment, 0);
+        headers[i].offset = file->size;
+        headers[i].size   = contents[i]->size;
+        output_append(file, contents[i]);
+    }
+
+    write_padding(file, 8, 0);
+    u64 section_header_offset = file->size;
+
+    for (u32 i = 0; i < count; i++) {
+        struct SectionHeader* header = &headers[i];
+
+        write_u32(file, name_offsets[i]);
+        write_u32(file, header->type);
+        write_u64(file, header->flags);
+        write_u64(file, header->address);
+        write_u64(file, (i == SECTION_NULL) ? 0 : header->offset);
+        write_u64(file, header->size);
+        write_u32(file, header->link);
+        write_u32(file, header->info);
+        write_u64(file, header->alignment);
+        write_u64(file, header->entry_size);
+    }
+
+    return section_header_offset;
+}
+
+static void write_elf_header(OutputBuffer* header, u16 type, u64 entry, u16 program_header_count, u64 section_header_offset, u16 section_count) {
+    static const u8 identification[16] = { 0x7f, 'E', 'L', 'F', 2, 1, 1 };
+
+    output_add(header, (const char *)identification, sizeof(identification));
+    write_u16(header, type);
+    write_u16(header, 62);                       // x86-64.
+    write_u32(header, 1);                        // Version.
+    write_u64(header, entry);
+    write_u64(header, (program_header_count) ? ELF_HEADER_SIZE : 0);
+    write_u64(header, section_header_offset);
+    write_u32(header, 0);                        // Flags.
+    write_u16(header, ELF_HEADER_SIZE);
+    write_u16(header, PROGRAM_HEADER_SIZE);
+    write_u16(header, program_header_count);
+    write_u16(header, SECTION_HEADER_SIZE);
+    write_u16(header, section_count);
+    write_u16(header, section_count - 1);        // The section name table is last.
+}
+
+static void init_writer(struct ObjectWriter* writer, OutputBuffer** fragments, u32 count) {
+    *writer = (struct ObjectWriter){ 0 };
+
+    for (u32 i = 0; i < OBJECT_SECTION_COUNT; i++) {
+        output_init(&writer->sections[i]);
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        read_fragment(writer, fragments[i]);
+    }
+
+    resolve_symbols(writer);
+}
+
+static void release_writer(struct ObjectWriter* writer) {
+    for (u32 i = 0; i < OBJECT_SECTION_COUNT; i++) {
+        output_release(&writer->sections[i]);
+    }
+
+    free(writer->symbols[0]);
+    free(writer->symbols[1]);
+    free(writer->relocations);
+}
+
+// Writes the ELF header in front of the file, and releases both.
+static void write_file(int fd, OutputBuffer* header, OutputBuffer* file) {
+    OutputBuffer* buffers[] = { header, file };
+    output_write(fd, buffers, 2);
+
+    output_release(header);
+    output_release(file);
+}
+
+void write_object_file(int fd, OutputBuffer** fragments, u32 count) {
+    struct ObjectWriter writer;
+    init_writer(&writer, fragments, count);
+
+    OutputBuffer rela;
+    output_init(&rela);
+
+    for (u32 i = 0; i < writer.relocation_count; i++) {
+        struct ObjectRelocation* relocation = &writer.relocations[i];
+
+        write_u64(&rela, relocation->offset);
+        write_u64(&rela, ((u64)relocation->index << 32) | relocation->type);
+        write_u64(&rela, (s64)relocation->addend);
+    }
+
+    OutputBuffer symtab;
+    OutputBuffer strtab;
+    output_init(&symtab);
+    output_init(&strtab);
+
+    static const u64 addresses[SECTION_BSS + 1] = { 0 };
+    write_symbol_table(&writer, addresses, &symtab, &strtab);
+
+    struct SectionHeader headers[SECTION_COUNT] = {
+        [SECTION_NULL]           = { .name = "" },
+        [SECTION_TEXT]           = { .name = ".text", .type = SHT_PROGBITS, .flags = SHF_ALLOC | SHF_EXECINSTR, .alignment = 16 },
+        [SECTION_DATA]           = { .name = ".data", .type = SHT_PROGBITS, .flags = SHF_WRITE | SHF_ALLOC, .alignment = 8 },
+        [SECTION_BSS]            = { .name = ".bss", .type = SHT_NOBITS, .flags = SHF_WRITE | SHF_ALLOC, .alignment = 8, .size = writer.bss_size },
+        [SECTION_RELA_TEXT]      = { .name = ".rela.text", .type = SHT_RELA, .flags = SHF_INFO_LINK, .link = SECTION_SYMTAB, .info = SECTION_TEXT, .alignment = 8, .entry_size = RELA_SIZE },
+        [SECTION_NOTE_GNU_STACK] = { .name = ".note.GNU-stack", .type = SHT_PROGBITS, .alignment = 1 },
+        [SECTION_SYMTAB]         = { .name = ".symtab", .type = SHT_SYMTAB, .link = SECTION_STRTAB, .info = 1 + writer.symbol_counts[0], .alignment = 8, .entry_size = SYMBOL_SIZE },
+        [SECTION_STRTAB]         = { .name = ".strtab", .type = SHT_STRTAB, .alignment = 1 },
+        [SECTION_SHSTRTAB]       = { .name = ".shstrtab", .type = SHT_STRTAB, .alignment = 1 },
+    };
+
+    OutputBuffer* contents[SECTION_COUNT] = {
+        [SECTION_TEXT]      = &writer.sections[OBJECT_TEXT],
+        [SECTION_DATA]      = &writer.sections[OBJECT_DATA],
+        [SECTION_RELA_TEXT] = &rela,
+        [SECTION_SYMTAB]    = &symtab,
+        [SECTION_STRTAB]    = &strtab,
+    };
+
+    // The section contents follow the ELF header, and the section headers come last.
+    OutputBuffer file;
+    output_init(&file);
+    file.size = ELF_HEADER_SIZE;
+
+    u64 section_header_offset = write_sections(&file, headers, contents, SECTION_COUNT);
+
+    OutputBuffer header;
+    output_init(&header);
+    write_elf_header(&header, ET_REL, 0, 0, section_header_offset, SECTION_COUNT);
+
+    write_file(fd, &header, &file);
+    release_writer(&writer);
+}
+
+// The runtime of a freestanding program is just the entry point. It passes argc and argv to main,
+// and exits with the value main returns, like the C library does.
+static const char runtime_start[] =
+    "mov $0, %rbp\n"
+    "mov (%rsp), %rdi\n"
+    "lea 8(%rsp), %rsi\n"
+    "call main\n"
+    "mov %rax, %rdi\n"
+    "mov $60, %rax\n"
+    "syscall\n";
+
+// Section header indices of the executable. The first sections are the same as in the object.
+enum {
+    EXECUTABLE_SYMTAB = SECTION_BSS + 1,
+    EXECUTABLE_STRTAB,
+    EXECUTABLE_SHSTRTAB,
+    EXECUTABLE_SECTION_COUNT
+};
+
+static void write_program_header(OutputBuffer* header, u32 type, u32 flags, u64 offset, u64 address, u64 file_size, u64 memory_size, u64 alignment) {
+    write_u32(header, type);
+    write_u32(header, flags);
+    write_u64(header, offset);
+    write_u64(header, address);
+    write_u64(header, address);
+    write_u64(header, file_size);
+    write_u64(header, memory_size);
+    write_u64(header, alignment);
+}
+
+// Copies the buffer into one piece of memory, so it can be patched.
+static u8* flatten_buffer(OutputBuffer* buffer) {
+    u8* data = malloc(buffer->size ? buffer->size : 1);
+    u64 size = 0;
+
+    for (OutputBlock* block = buffer->first; block; block = block->next) {
+        __builtin_memcpy(data + size, block->data, block->size);
+        size += block->size;
+    }
+
+    return data;
+}
+
+void write_executable_file(int fd, OutputBuffer** fragments, u32 count) {
+    // The runtime goes first, so the program starts at the beginning of the text.
+    OutputBuffer** all_fragments = malloc((count + 1) * sizeof(OutputBuffer*));
+    OutputBuffer runtime;
+    output_init(&runtime);
+
+    String start_name = make_string("_start");
+    MachineCode start = { 0 };
+    encode_assembly(&start, make_string(runtime_start), start_name);
+    finish_machine_code(&start, start_name, &runtime);
+
+    all_fragments[0] = &runtime;
+    for (u32 i = 0; i < count; i++) {
+        all_fragments[i + 1] = fragments[i];
+    }
+
+    struct ObjectWriter writer;
+    init_writer(&writer, all_fragments, count + 1);
+
+    // Undefined symbols are all globals at the end.
+    bool undefined = false;
+    for (u32 i = 0; i < writer.symbol_counts[1]; i++) {
+        struct ObjectSymbol* symbol = &writer.symbols[1][i];
+
+        if (symbol->section == SECTION_NULL) {
+            printf("Linker : undefined symbol %.*s\n", symbol->name.size, symbol->name.text);
+            undefined = true;
+        }
+    }
+
+    if (undefined) {
+        exit(1);
+    }
+
+    // The text segment maps the headers and the code, and the data segment starts on the next page
+    // with the data followed by the zeroed globals.
+    u64 text_offset = align_up(ELF_HEADER_SIZE + EXECUTABLE_SEGMENT_COUNT * PROGRAM_HEADER_SIZE, 16);
+    u64 text_size   = writer.sections[OBJECT_TEXT].size;
+    u64 data_offset = align_up(text_offset + text_size, PAGE_SIZE);
+    u64 data_size   = writer.sections[OBJECT_DATA].size;
+
+    u64 addresses[SECTION_BSS + 1] = {
+        [SECTION_TEXT] = EXECUTABLE_BASE + text_offset,
+        [SECTION_DATA] = EXECUTABLE_BASE + data_offset,
+        [SECTION_BSS]  = align_up(EXECUTABLE_BASE + data_offset + data_size, 8),
+    };
+
+    // Every relocation is relative to the place it patches, so the code does not depend on where
+    // it is loaded.
+    u8* text = flatten_buffer(&writer.sections[OBJECT_TEXT]);
+
+    for (u32 i = 0; i < writer.relocation_count; i++) {
+        struct ObjectRelocation* relocation = &writer.relocations[i];
+        struct ObjectSymbol* symbol = get_symbol(&writer, relocation->index);
+
+        s64 target = addresses[symbol->section] + symbol->value;
+        s64 place  = addresses[SECTION_TEXT] + relocation->offset;
+        s64 value  = target + relocation->addend - place;
+
+        if (value < INT32_MIN || value > INT32_MAX) {
+            printf("Linker : relocation against %.*s is out of range\n", symbol->name.size, symbol->name.text);
+            exit(1);
+        }
+
+        s32 displacement = value;
+        __builtin_memcpy(text + relocation->offset, &displacement, 4);
+    }
+
+    output_release(&writer.sections[OBJECT_TEXT]);
+    output_add(&writer.sections[OBJECT_TEXT], (const char *)text, text_size);
+    free(text);
+
+    OutputBuffer symtab;
+    OutputBuffer strtab;
+    output_init(&symtab);
+    output_init(&strtab);
+    write_symbol_table(&writer, addresses, &symtab, &strtab);
+
+    u64 bss_end = addresses[SECTION_BSS] + writer.bss_size;
+
+    struct SectionHeader headers[EXECUTABLE_SECTION_COUNT] = {
+        [SECTION_NULL]        = { .name = "" },
+        [SECTION_TEXT]        = { .name = ".text", .type = SHT_PROGBITS, .flags = SHF_ALLOC | SHF_EXECINSTR, .address = addresses[SECTION_TEXT], .alignment = 16 },
+        [SECTION_DATA]        = { .name = ".data", .type = SHT_PROGBITS, .flags = SHF_WRITE | SHF_ALLOC, .address = addresses[SECTION_DATA], .alignment = 8, .file_alignment = PAGE_SIZE },
+        [SECTION_BSS]         = { .name = ".bss", .type = SHT_NOBITS, .flags = SHF_WRITE | SHF_ALLOC, .address = addresses[SECTION_BSS], .alignment = 8, .size = writer.bss_size },
+        [EXECUTABLE_SYMTAB]   = { .name = ".symtab", .type = SHT_SYMTAB, .link = EXECUTABLE_STRTAB, .info = 1 + writer.symbol_counts[0], .alignment = 8, .entry_size = SYMBOL_SIZE },
+        [EXECUTABLE_STRTAB]   = { .name = ".strtab", .type = SHT_STRTAB, .alignment = 1 },
+        [EXECUTABLE_SHSTRTAB] = { .name = ".shstrtab", .type = SHT_STRTAB, .alignment = 1 },
+    };
+
+    OutputBuffer* contents[EXECUTABLE_SECTION_COUNT] = {
+        [SECTION_TEXT]      = &writer.sections[OBJECT_TEXT],
+        [SECTION_DATA]      = &writer.sections[OBJECT_DATA],
+        [EXECUTABLE_SYMTAB] = &symtab,
+        [EXECUTABLE_STRTAB] = &strtab,
+    };
+
+    OutputBuffer file;
+    output_init(&file);
+    file.size = ELF_HEADER_SIZE + EXECUTABLE_SEGMENT_COUNT * PROGRAM_HEADER_SIZE;
+
+    u64 section_header_offset = write_sections(&file, headers, contents, EXECUTABLE_SECTION_COUNT);
+    assert(headers[SECTION_TEXT].offset == text_offset && headers[SECTION_DATA].offset == data_offset);
+
+    OutputBuffer header;
+    output_init(&header);
+    write_elf_header(&header, ET_EXEC, addresses[SECTION_TEXT], EXECUTABLE_SEGMENT_COUNT, section_header_offset, EXECUTABLE_SECTION_COUNT);
+
+    write_program_header(&header, PT_LOAD, PF_R | PF_X, 0, EXECUTABLE_BASE, text_offset + text_size, text_offset + text_size, PAGE_SIZE);
+    write_program_header(&header, PT_LOAD, PF_R | PF_W, data_offset, addresses[SECTION_DATA], data_size, bss_end - addresses[SECTION_DATA], PAGE_SIZE);
+    write_program_header(&header, PT_GNU_STACK, PF_R | PF_W, 0, 0, 0, 0, 16);
+
+    write_file(fd, &header, &file);
+    release_writer(&writer);
+    output_release(&runtime);
+    free(all_fragments);
+}
@@ -0,0 +1,153 @@
+// Copyright (C) strawberryhacker.
+//
+// This file implements the chunked output buffer used by the code generator. Appending never 
+// reallocates, and the finished output is written with writev straight from the blocks, so the 
+// text is copied exactly once - from the emitter into a block.
+
+#include <output.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+// Number of blocks passed to each writev. This is the IOV_MAX limit on Linux.
+#define OUTPUT_VECTOR_COUNT 1024
+
+static OutputBlock* new_output_block(u32 capacity) {
+    OutputBlock* block = malloc(sizeof(OutputBlock) + capacity);
+    if (block == 0) {
+        printf("Output : malloc failed\n");
+        exit(1);
+    }
+
+    block->next     = 0;
+    block->size     = 0;
+    block->capacity = capacity;
+    return block;
+}
+
+void output_init(OutputBuffer* buffer) {
+    buffer->first       = 0;
+    buffer->last        = 0;
+    buffer->block_count = 0;
+    buffer->size        = 0;
+}
+
+void output_add(OutputBuffer* buffer, const char* data, u32 size) {
+    buffer->size += size;
+
+    while (size) {
+        OutputBlock* block = buffer->last;
+
+        if (block == 0 || block->size == block->capacity) {
+            u32 capacity = (block) ? 2 * block->capacity : OUTPUT_FIRST_BLOCK_SIZE;
+            if (capacity > OUTPUT_MAX_BLOCK_SIZE) {
+                capacity = OUTPUT_MAX_BLOCK_SIZE;
+            }
+
+            OutputBlock* new_block = new_output_block(capacity);
+
+            if (block) {
+                block->next = new_block;
+            }
+            else {
+                buffer->first = new_block;
+            }
+
+            buffer->last = new_block;
+            buffer->block_count++;
+            block = new_block;
+        }
+
+        u32 count = block->capacity - block->size;
+        if (count > size) {
+            count = size;
+        }
+
+        // Note that string.h is shadowed by include/string.h, so we use the builtin directly.
+        __builtin_memcpy(block->data + block->size, data, count);
+        block->size += count;
+
+        data += count;
+        size -= count;
+    }
+}
+
+void output_append(OutputBuffer* destination, OutputBuffer* source) {
+    if (source->first == 0) {
+        return;
+    }
+
+    if (destination->last) {
+        destination->last->next = source->first;
+    }
+    else {
+        destination->first = source->first;
+    }
+
+    destination->last         = source->last;
+    destination->block_count += source->block_count;
+    destination->size        += source->size;
+
+    output_init(source);
+}
+
+// Writes the vectors, and handles partial writes by advancing past the bytes already written.
+static void write_vectors(int fd, struct iovec* vectors, u32 count) {
+    while (count) {
+        ssize_t written = writev(fd, vectors, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            printf("Output : write failed\n");
+            exit(1);
+        }
+
+        while (count && (size_t)written >= vectors->iov_len) {
+            written -= vectors->iov_len;
+            vectors++;
+            count--;
+        }
+
+        if (count) {
+            vectors->iov_base = (char *)vectors->iov_base + written;
+            vectors->iov_len -= written;
+        }
+    }
+}
+
+void output_write(int fd, OutputBuffer** buffers, u32 count) {
+    struct iovec vectors[OUTPUT_VECTOR_COUNT];
+    u32 vector_count = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        for (OutputBlock* block = buffers[i]->first; block; block = block->next) {
+            if (block->size == 0) {
+                continue;
+            }
+
+            if (vector_count == OUTPUT_VECTOR_COUNT) {
+                write_vectors(fd, vectors, vector_count);
+                vector_count = 0;
+            }
+
+            vectors[vector_count].iov_base = block->data;
+            vectors[vector_count].iov_len  = block->size;
+            vector_count++;
+        }
+    }
+
+    write_vectors(fd, vectors, vector_count);
+}
+
+void output_release(OutputBuffer* buffer) {
+    OutputBlock* block = buffer->first;
+    while (block) {
+        OutputBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    output_init(buffer);
+}
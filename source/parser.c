@@ -19,16 +19,24 @@
 
 #include <parser.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <list.h>
 #include <assert.h>
 #include <error.h>
 #include <typer.h>
+#include <arena.h>
+#include <source.h>
+#include <string.h>
+#include <cache.h>
+#include <interface.h>
+#include <trace.h>
 
 static Expression* parse_expression(Parser* parser, s8 priority);
 static Expression* parse_unary_expression(Parser* parser);
 static Expression* parse_primary_expression(Parser* parser);
 static Expression* parse_suffix_expression(Parser* parser, Expression* previous);
 static Statement* parse_compound_statement(Parser* parser);
+static bool skim_compound_statement(Parser* parser);
 static Statement* parse_expression_statement(Parser* parser);
 static Statement* parse_block(Parser* parser);
 static Statement* parse_compound_statement(Parser* parser);
@@ -42,26 +50,44 @@ static bool try_parse_declaration(Parser* parser, Statement** statement);
 static Scope* enter_scope(Parser* parser);
 static void exit_scope(Parser* parser);
 
+// Bodies of global functions are skimmed instead of parsed, see parse_function_bodies.
+static bool skim_bodies;
+
 // All initial calls to parse_expression must use this initial priority.
 static const s8 EXPRESSION_INIT_PRIORITY = -1;
 
-// Since the lexer is not allocating any memory for the tokens (except for the initial fixed size 
-// token buffer), we need to manually copy all tokens we want to store.
-static Token* copy_token(Token* token) {
-    Token* new_token = calloc(1, sizeof(Token));
+static void push_child(Parser* parser, void* child) {
+    if (parser->child_count == parser->child_capacity) {
+        parser->child_capacity = (parser->child_capacity) ? parser->child_capacity * 2 : 64;
+        parser->children = realloc(parser->children, parser->child_capacity * sizeof(void *));
 
-    u8* source = (u8 *)token;
-    u8* dest   = (u8 *)new_token;
+        if (parser->children == 0) {
+            printf("Parser : realloc failed\n");
+            exit(1);
+        }
+    }
+
+    parser->children[parser->child_count++] = child;
+}
 
-    for (u32 i = 0; i < sizeof(Token); i++) {
-        *dest++ = *source++;
+// Moves the children pushed since 'first' into an array in the arena, and removes them from the 
+// stack.
+static void* pop_children(Parser* parser, u32 first, AllocationKind kind, u32* count) {
+    *count = parser->child_count - first;
+
+    if (*count == 0) {
+        return 0;
     }
 
-    return new_token;
+    void** children = phase_allocate(kind, *count * sizeof(void *));
+    __builtin_memcpy(children, &parser->children[first], *count * sizeof(void *));
+
+    parser->child_count = first;
+    return children;
 }
 
-static BinaryKind token_to_binary_kind(Token* token) {
-    switch (token->kind) {
+static BinaryKind token_to_binary_kind(u32 token) {
+    switch (get_token_kind(token)) {
         case TOKEN_EQUAL          : return BINARY_EQUAL;
         case TOKEN_NOT_EQUAL      : return BINARY_NOT_EQUAL;
         case TOKEN_GREATER        : return BINARY_GREATER;
@@ -78,8 +104,8 @@ static BinaryKind token_to_binary_kind(Token* token) {
     return 0;
 };
 
-static s8 get_binary_precedence(Token* token) {
-    switch (token->kind) {
+static s8 get_binary_precedence(u32 token) {
+    switch (get_token_kind(token)) {
         case TOKEN_MULTIPLICATION:
         case TOKEN_DIVISION:
             return 30;
@@ -119,7 +145,7 @@ static Expression* parse_expression(Parser* parser, s8 priority) {
     Expression* left = parse_unary_expression(parser);
 
     while (1) {
-        Token* token = current_token(lexer);
+        u32 token = current_token(lexer);
 
         s8 new_priority = get_binary_precedence(token);
         
@@ -130,7 +156,7 @@ static Expression* parse_expression(Parser* parser, s8 priority) {
 
         Binary* binary = new_binary(token_to_binary_kind(token));
 
-        binary->operator = copy_token(consume_token(lexer));
+        binary->operator = consume_token(lexer);
         binary->left     = left;
         binary->right    = parse_expression(parser, new_priority);
 
@@ -141,9 +167,9 @@ static Expression* parse_expression(Parser* parser, s8 priority) {
 
 static Expression* parse_unary_expression(Parser* parser) {
     Lexer* lexer = parser->lexer;
-    Token* token = consume_token(lexer);
+    u32 token = consume_token(lexer);
 
-    if (token->kind == TOKEN_OPEN_PARENTHESIS) {
+    if (get_token_kind(token) == TOKEN_OPEN_PARENTHESIS) {
         // Parenthesised expression.
         Expression* expression = parse_expression(parser, EXPRESSION_INIT_PRIORITY);
         skip_token(lexer, TOKEN_CLOSE_PARENTHESIS);
@@ -152,20 +178,20 @@ static Expression* parse_unary_expression(Parser* parser) {
         // (data + 2)[4] should work assuming data is a pointer.
         return parse_suffix_expression(parser, expression);
     }
-    else if (token->kind == TOKEN_MULTIPLICATION) {
+    else if (get_token_kind(token) == TOKEN_MULTIPLICATION) {
         // Address of.
         Unary* unary = new_unary(UNARY_ADDRESS_OF);
 
-        unary->operator = copy_token(token);
+        unary->operator = token;
         unary->operand  = parse_unary_expression(parser);
 
         return (Expression *)unary;
     }
-    else if (token->kind == TOKEN_AT) {
+    else if (get_token_kind(token) == TOKEN_AT) {
         // Dereference.
         Unary* unary = new_unary(UNARY_DEREF);
 
-        unary->operator = copy_token(token);
+        unary->operator = token;
         unary->operand  = parse_unary_expression(parser);
 
         return (Expression *)unary;
@@ -179,26 +205,25 @@ static Expression* parse_unary_expression(Parser* parser) {
 
 static Expression* parse_primary_expression(Parser* parser) {
     Lexer* lexer = parser->lexer;
-    Token* token = consume_token(lexer);
+    u32 token = consume_token(lexer);
 
     Primary* primary = new_expression(EXPRESSION_PRIMARY);
 
-    primary->token = copy_token(token);
+    primary->token = token;
 
-    switch (token->kind) {
+    switch (get_token_kind(token)) {
         case TOKEN_NUMBER : {
             primary->kind   = PRIMARY_NUMBER;
-            primary->number = token->number;
+            primary->number = get_token_number(token);
             break;
         }
         case TOKEN_IDENTIFIER : {
-            primary->kind = PRIMARY_IDENTIFIER;
-            primary->name = primary->token->name;
+            primary->kind   = PRIMARY_IDENTIFIER;
+            primary->symbol = get_token_symbol(token);
             break;
         }
         case TOKEN_STRING : {
-            primary->kind   = PRIMARY_STRING;
-            primary->string = token->name;
+            primary->kind = PRIMARY_STRING;
             break;
         }
         default : {
@@ -211,40 +236,42 @@ static Expression* parse_primary_expression(Parser* parser) {
 
 static Expression* parse_suffix_expression(Parser* parser, Expression* previous) {
     Lexer* lexer = parser->lexer;
-    Token* token = consume_token(lexer);
+    u32 token = consume_token(lexer);
 
-    if (token->kind == TOKEN_OPEN_PARENTHESIS) {
+    if (get_token_kind(token) == TOKEN_OPEN_PARENTHESIS) {
         // Function call expression.
         Call* call = new_call();
 
         call->expression = previous;
-        call->token      = copy_token(token);
+        call->token      = token;
 
+        u32 first = parser->child_count;
         token = current_token(lexer);
 
-        while (token->kind != TOKEN_CLOSE_PARENTHESIS && token->kind != TOKEN_END_OF_FILE) {
+        while (get_token_kind(token) != TOKEN_CLOSE_PARENTHESIS && get_token_kind(token) != TOKEN_END_OF_FILE) {
 
-            Expression* expression = parse_expression(parser, EXPRESSION_INIT_PRIORITY);
-            list_add_last(&expression->list_node, &call->arguments);
+            push_child(parser, parse_expression(parser, EXPRESSION_INIT_PRIORITY));
             
             token = current_token(lexer);
 
-            if (token->kind != TOKEN_CLOSE_PARENTHESIS) {
+            if (get_token_kind(token) != TOKEN_CLOSE_PARENTHESIS) {
                 token = skip_token(lexer, TOKEN_COMMA);
             }
         }
 
+        call->arguments = pop_children(parser, first, ALLOCATION_EXPRESSION, &call->argument_count);
+
         skip_token(lexer, TOKEN_CLOSE_PARENTHESIS);
         return parse_suffix_expression(parser, (Expression *)call);
     }
-    else if (token->kind == TOKEN_OPEN_SQUARE) {
+    else if (get_token_kind(token) == TOKEN_OPEN_SQUARE) {
         // Array expression.
         // We do not have any separate structure for the array expresion since it is basically just 
         // a deref. Thus we convert array[10] to *(array + 10).
         Unary* unary = new_expression(EXPRESSION_UNARY);
         Binary* binary = new_binary(BINARY_PLUS);
 
-        binary->operator = copy_token(token);
+        binary->operator = token;
         binary->left     = previous;
         binary->right    = parse_expression(parser, EXPRESSION_INIT_PRIORITY);
 
@@ -255,12 +282,12 @@ static Expression* parse_suffix_expression(Parser* parser, Expression* previous)
         skip_token(lexer, TOKEN_CLOSE_SQUARE);
         return parse_suffix_expression(parser, (Expression *)unary);
     }
-    else if (token->kind == TOKEN_DOT) {
+    else if (get_token_kind(token) == TOKEN_DOT) {
         // Struct member access.
         Dot* dot = new_expression(EXPRESSION_DOT);
 
-        dot->dot_token  = copy_token(token);
-        dot->member     = copy_token(current_token(lexer));
+        dot->dot_token  = token;
+        dot->member     = current_token(lexer);
         dot->expression = previous;
         
         skip_token(lexer, TOKEN_IDENTIFIER);
@@ -282,7 +309,7 @@ static Statement* parse_expression_statement(Parser* parser) {
 
 static Statement* parse_conditional_statement(Parser* parser) {
     Lexer* lexer = parser->lexer;
-    Token* token = next_token(lexer);
+    u32 token = next_token(lexer);
 
     Conditional* conditional = new_statement(STATEMENT_CONDITIONAL);
 
@@ -307,7 +334,7 @@ static Statement* parse_conditional_statement(Parser* parser) {
 
 static Statement* parse_while_statement(Parser* parser) {
     Lexer* lexer = parser->lexer;
-    Token* token = next_token(lexer);
+    u32 token = next_token(lexer);
 
     Loop* loop = new_statement(STATEMENT_LOOP);
 
@@ -320,13 +347,14 @@ static Statement* parse_while_statement(Parser* parser) {
 // // Fix this crap.
 static Statement* parse_for_statement(Parser* parser) {
     Lexer* lexer = parser->lexer;
-    Token* token = expect_token(lexer, TOKEN_IDENTIFIER);
+    u32 token = expect_token(lexer, TOKEN_IDENTIFIER);
 
     Declaration* declaration = new_declaration();
 
     declaration->kind       = DECLARATION_VARIABLE;
-    declaration->name_token = copy_token(token);
-    declaration->name       = token->name;
+    declaration->name_token = token;
+    declaration->name       = get_token_name(token);
+    declaration->symbol     = get_token_symbol(token);
     declaration->type       = new_type(TYPE_INFERRED);
 
     Loop* loop = new_statement(STATEMENT_LOOP);
@@ -335,7 +363,8 @@ static Statement* parse_for_statement(Parser* parser) {
     skip_keyword(lexer, KEYWORD_IN);
 
     Primary* name = new_primary(PRIMARY_IDENTIFIER);
-    name->name = declaration->name;
+    name->token  = declaration->name_token;
+    name->symbol = declaration->symbol;
     name->declaration = declaration;
     
     Binary* assign = new_binary(BINARY_ASSIGN);
@@ -382,32 +411,35 @@ static Statement* parse_for_statement(Parser* parser) {
 
 static Statement* parse_statement(Parser* parser) {
     Lexer* lexer = parser->lexer;
-    Token* token = current_token(lexer);
+    u32 token = current_token(lexer);
 
-    if (token->kind == TOKEN_COMMENT) {
+    if (get_token_kind(token) == TOKEN_COMMENT) {
         Statement* statement = new_statement(STATEMENT_COMMENT);
-        statement->comment.token = copy_token(token);
+        statement->comment.token = token;
         skip_token(lexer, TOKEN_COMMENT);
         return statement;
     }
-    else if (token->kind == TOKEN_OPEN_CURLY) {
+    else if (get_token_kind(token) == TOKEN_OPEN_CURLY) {
         return parse_compound_statement(parser);
     }
-    else if (is_keyword(token, KEYWORD_RETURN)) {
-        ReturnStatement* Return = new_statement(STATEMENT_RETURN);
-        skip_token(lexer, TOKEN_IDENTIFIER);
-        Return->return_expression = parse_expression(parser, EXPRESSION_INIT_PRIORITY);
-        skip_token(lexer, TOKEN_SEMICOLON); 
-        return (Statement *)Return;
-    }
-    else if (is_keyword(token, KEYWORD_FOR)) {
-        return parse_for_statement(parser);
-    }
-    else if (is_keyword(token, KEYWORD_IF)) {
-        return parse_conditional_statement(parser);
-    }
-    else if (is_keyword(token, KEYWORD_WHILE)) {
-        return parse_while_statement(parser);
+
+    switch (get_token_keyword(token)) {
+        case KEYWORD_RETURN : {
+            ReturnStatement* Return = new_statement(STATEMENT_RETURN);
+            skip_token(lexer, TOKEN_IDENTIFIER);
+            Return->return_expression = parse_expression(parser, EXPRESSION_INIT_PRIORITY);
+            skip_token(lexer, TOKEN_SEMICOLON); 
+            return (Statement *)Return;
+        }
+        case KEYWORD_FOR : {
+            return parse_for_statement(parser);
+        }
+        case KEYWORD_IF : {
+            return parse_conditional_statement(parser);
+        }
+        case KEYWORD_WHILE : {
+            return parse_while_statement(parser);
+        }
     }
 
     return parse_expression_statement(parser);
@@ -432,52 +464,37 @@ static Statement* try_parse_declaration_or_statement(Parser* parser) {
 
 static Type* parse_type(Parser* parser) {
     Lexer* lexer = parser->lexer;
-    Token* token = consume_token(lexer);
-
-    if (is_keyword(token, KEYWORD_U64)) {
-        return type_u64;
-    }
-    else if (is_keyword(token, KEYWORD_U32)) {
-        return type_u32;
-    }
-    else if (is_keyword(token, KEYWORD_U16)) {
-        return type_u16;
-    }
-    else if (is_keyword(token, KEYWORD_U8)) {
-        return type_u8;
-    }
-    else if (is_keyword(token, KEYWORD_S64)) {
-        return type_s64;
-    }
-    else if (is_keyword(token, KEYWORD_S32)) {
-        return type_s32;
-    }
-    else if (is_keyword(token, KEYWORD_S16)) {
-        return type_s16;
+    u32 token = consume_token(lexer);
+
+    switch (get_token_keyword(token)) {
+        case KEYWORD_U64  : return type_u64;
+        case KEYWORD_U32  : return type_u32;
+        case KEYWORD_U16  : return type_u16;
+        case KEYWORD_U8   : return type_u8;
+        case KEYWORD_S64  : return type_s64;
+        case KEYWORD_S32  : return type_s32;
+        case KEYWORD_S16  : return type_s16;
+        case KEYWORD_S8   : return type_s8;
+        case KEYWORD_CHAR : return type_char;
     }
-    else if (is_keyword(token, KEYWORD_S8)) {
-        return type_s8;
-    }
-    else if (is_keyword(token, KEYWORD_CHAR)) {
-        return type_char;
-    }
-    else if (token->kind == TOKEN_MULTIPLICATION) {
+
+    if (get_token_kind(token) == TOKEN_MULTIPLICATION) {
         // Pointer.
         PointerType* pointer = new_pointer();
         pointer->pointer_to = parse_type(parser);
         return (Type *)pointer;
     }
-    else if (token->kind == TOKEN_OPEN_SQUARE) {
+    else if (get_token_kind(token) == TOKEN_OPEN_SQUARE) {
         // Array.
         token = current_token(lexer);
         
         // The array expression must be known at compile-time.
-        if (token->kind != TOKEN_NUMBER) {
+        if (get_token_kind(token) != TOKEN_NUMBER) {
             error_token(token, "cannot evaluate non-constant expressions currently");
         }
 
         Type* type = new_pointer();
-        type->pointer.count = token->number;
+        type->pointer.count = get_token_number(token);
 
         skip_token(lexer, TOKEN_NUMBER);
         skip_token(lexer, TOKEN_CLOSE_SQUARE);
@@ -485,11 +502,11 @@ static Type* parse_type(Parser* parser) {
         type->pointer.pointer_to = parse_type(parser);
         return type;
     }
-    else if (token->kind == TOKEN_IDENTIFIER) {
+    else if (get_token_kind(token) == TOKEN_IDENTIFIER) {
         // At this point we do not know if the identifier is a valid typedef. We mark it as unknown 
         // and resolves it in a later pass.
         Type* type = new_type(TYPE_UNKNOWN);
-        type->unknown.token = copy_token(token);
+        type->unknown.token = token;
         return type;
     }
 
@@ -504,14 +521,15 @@ static void parse_function_argument(Parser* parser) {
     Declaration* declaration = new_declaration();
 
     declaration->kind       = DECLARATION_VARIABLE;
-    declaration->name_token = copy_token(consume_token(lexer));
-    declaration->name       = declaration->name_token->name;
+    declaration->name_token = consume_token(lexer);
+    declaration->name       = get_token_name(declaration->name_token);
+    declaration->symbol     = get_token_symbol(declaration->name_token);
 
     skip_token(lexer, TOKEN_COLON);
 
     declaration->type = parse_type(parser);
 
-    if (declaration->name_token->kind != TOKEN_IDENTIFIER) {
+    if (get_token_kind(declaration->name_token) != TOKEN_IDENTIFIER) {
         error_token(declaration->name_token, "expecting an identifier as a function argument.");
     }
 
@@ -555,7 +573,7 @@ static bool does_struct_member_exist(StructMember* member, Parser* parser) {
         StructMember* scope_member = list_to_struct(it, StructMember, scope_node);
 
         assert(scope_member->is_anonymous == false);
-        if (string_compare(&member->name, &scope_member->name)) {
+        if (member->symbol == scope_member->symbol) {
             return true;
         }
     }
@@ -570,11 +588,11 @@ static bool does_struct_member_exist(StructMember* member, Parser* parser) {
 // will the structure in this case have a scope or not?
 static StructMember* parse_struct_member(Parser* parser) {
     Lexer* lexer = parser->lexer;
-    Token* token = current_token(lexer);
+    u32 token = current_token(lexer);
 
     assert(parser->current_struct_scope);
 
-    if (token->kind != TOKEN_IDENTIFIER) {
+    if (get_token_kind(token) != TOKEN_IDENTIFIER) {
         error_token(token, "expecting either a tag or a struct / union keyword.");
     }
 
@@ -583,8 +601,9 @@ static StructMember* parse_struct_member(Parser* parser) {
 
     if (!is_keyword(token, KEYWORD_STRUCT) && !is_keyword(token, KEYWORD_UNION)) {
         // Tagged struct or a regular struct member.
-        member->token        = copy_token(token);
-        member->name         = token->name;
+        member->token        = token;
+        member->name         = get_token_name(token);
+        member->symbol       = get_token_symbol(token);
         member->is_anonymous = false;
 
         token = skip_token(lexer, TOKEN_IDENTIFIER);
@@ -604,7 +623,7 @@ static StructMember* parse_struct_member(Parser* parser) {
 
 static Type* parse_struct_declaration(Parser* parser, bool is_anonymous) {
     Lexer* lexer = parser->lexer;
-    Token* token = consume_token(lexer);
+    u32 token = consume_token(lexer);
 
     StructType* type = new_struct();
     type->is_struct = is_keyword(token, KEYWORD_STRUCT);
@@ -616,7 +635,7 @@ static Type* parse_struct_declaration(Parser* parser, bool is_anonymous) {
 
     token = skip_token(lexer, TOKEN_OPEN_CURLY);
 
-    while (token->kind != TOKEN_CLOSE_CURLY && token->kind != TOKEN_END_OF_FILE) {
+    while (get_token_kind(token) != TOKEN_CLOSE_CURLY && get_token_kind(token) != TOKEN_END_OF_FILE) {
         StructMember* member = parse_struct_member(parser);
         
         list_add_last(&member->list_node, &type->members);
@@ -644,30 +663,33 @@ static Type* parse_struct_declaration(Parser* parser, bool is_anonymous) {
 // return that in the init_statement.
 static bool try_parse_declaration(Parser* parser, Statement** init_statement) {
     Lexer* lexer = parser->lexer;
-    Token* token = current_token(lexer);
-    Token* next  = peek_next(lexer);
+    u32 token = current_token(lexer);
+    u32 next   = peek_next(lexer);
 
     *init_statement = 0;
 
-    if (token->kind != TOKEN_IDENTIFIER) {
+    if (get_token_kind(token) != TOKEN_IDENTIFIER) {
         return false;
     }
 
-    if (next->kind != TOKEN_COLON && next->kind != TOKEN_DOUBLE_COLON) {
+    if (get_token_kind(next) != TOKEN_COLON && get_token_kind(next) != TOKEN_DOUBLE_COLON) {
         return false;
     }
 
     Declaration* declaration = new_declaration();
 
-    declaration->name_token = copy_token(token);
-    declaration->name       = token->name;
+    declaration->name_token = token;
+    declaration->name       = get_token_name(token);
+    declaration->symbol     = get_token_symbol(token);
 
-    bool is_typedef = (next->kind == TOKEN_DOUBLE_COLON);
+    bool is_typedef = (get_token_kind(next) == TOKEN_DOUBLE_COLON);
 
     token = next_token(lexer);   // Skip the declaration name.
     token = next_token(lexer);   // Skip the :: or :
 
-    if ((is_keyword(token, KEYWORD_FUNC) || is_keyword(token, KEYWORD_ASM)) && !is_typedef) {
+    KeywordKind keyword = get_token_keyword(token);
+
+    if ((keyword == KEYWORD_FUNC || keyword == KEYWORD_ASM) && !is_typedef) {
         declaration->kind = DECLARATION_FUNCTION;
     
         // Each function contains at least two scopes. The first scope is opened here, and will 
@@ -677,18 +699,18 @@ static bool try_parse_declaration(Parser* parser, Statement** init_statement) {
         Function* function = &declaration->function;
 
         function->function_scope    = scope;
-        function->assembly_function = is_keyword(token, KEYWORD_ASM);
+        function->assembly_function = (keyword == KEYWORD_ASM);
 
         token = skip_token(lexer, TOKEN_IDENTIFIER);
         token = skip_token(lexer, TOKEN_OPEN_PARENTHESIS);
         
         // Parse the function argumenets.
-        while (token->kind != TOKEN_CLOSE_PARENTHESIS && token->kind != TOKEN_END_OF_FILE) {
+        while (get_token_kind(token) != TOKEN_CLOSE_PARENTHESIS && get_token_kind(token) != TOKEN_END_OF_FILE) {
             parse_function_argument(parser);
 
             token = current_token(lexer);
 
-            if (token->kind != TOKEN_CLOSE_PARENTHESIS) {
+            if (get_token_kind(token) != TOKEN_CLOSE_PARENTHESIS) {
                 token = skip_token(lexer, TOKEN_COMMA);
             }
         }
@@ -696,33 +718,40 @@ static bool try_parse_declaration(Parser* parser, Statement** init_statement) {
         token = skip_token(lexer, TOKEN_CLOSE_PARENTHESIS);
 
         // Parse the function return type.
-        if (token->kind == TOKEN_ARROW) {
+        if (get_token_kind(token) == TOKEN_ARROW) {
             skip_token(lexer, TOKEN_ARROW);
             function->return_type = parse_type(parser);
         }
 
+        function->body_start = current_token(lexer);
+
         // Fix: this has to be fixed.
         if (function->assembly_function) {
             token = skip_token(lexer, TOKEN_OPEN_CURLY);
 
-            function->assembly_body = current_token(lexer)->name;
+            function->assembly_body = get_token_name(current_token(lexer));
 
-            while (token->kind != TOKEN_CLOSE_CURLY && token->kind != TOKEN_END_OF_FILE) {
+            while (get_token_kind(token) != TOKEN_CLOSE_CURLY && get_token_kind(token) != TOKEN_END_OF_FILE) {
                 token = next_token(lexer);
             }
 
-            function->assembly_body.size = token->name.text - function->assembly_body.text;
+            function->assembly_body.size = get_token_name(token).text - function->assembly_body.text;
             skip_token(lexer, TOKEN_CLOSE_CURLY);
         }
+        else if (skim_bodies && scope->depth == 1 && skim_compound_statement(parser)) {
+            function->is_skimmed = true;
+        }
         else {
             function->body = parse_compound_statement(parser);
         }
 
+        function->body_end = current_token(lexer);
+
         exit_scope(parser);
         push_declaration_on_current_scope(declaration, parser);
         return true;
     }
-    else if (is_keyword(token, KEYWORD_STRUCT) || is_keyword(token, KEYWORD_UNION)) {
+    else if (keyword == KEYWORD_STRUCT || keyword == KEYWORD_UNION) {
         declaration->kind = (is_typedef) ? DECLARATION_TYPE : DECLARATION_VARIABLE;
         declaration->type = parse_struct_declaration(parser, false);
 
@@ -731,7 +760,7 @@ static bool try_parse_declaration(Parser* parser, Statement** init_statement) {
         push_declaration_on_current_scope(declaration, parser);
         return true;
     }
-    else if (token->kind == TOKEN_ASSIGN && !is_typedef) {
+    else if (get_token_kind(token) == TOKEN_ASSIGN && !is_typedef) {
         // Inferred type.
         declaration->kind = DECLARATION_VARIABLE;
         declaration->type = new_type(TYPE_INFERRED);
@@ -752,16 +781,16 @@ static bool try_parse_declaration(Parser* parser, Statement** init_statement) {
     // If the declaration contains an init expression we are parsing that here.
     // Todo: how should we handle global scope?
     token = current_token(lexer);
-    if (token->kind == TOKEN_ASSIGN) {
+    if (get_token_kind(token) == TOKEN_ASSIGN) {
 
         Binary* assign = new_binary(BINARY_ASSIGN);
         Primary* primary = new_primary(PRIMARY_IDENTIFIER);
         Statement* statement = new_statement(STATEMENT_EXPRESSION);
 
-        primary->token = declaration->name_token;
-        primary->name  = declaration->name;
+        primary->token  = declaration->name_token;
+        primary->symbol = declaration->symbol;
         
-        assign->operator = copy_token(consume_token(lexer)); // Skip the assign token.
+        assign->operator = consume_token(lexer); // Skip the assign token.
         assign->left     = (Expression *)primary;
         assign->right    = parse_expression(parser, EXPRESSION_INIT_PRIORITY);
 
@@ -785,6 +814,7 @@ static Scope* enter_scope(Parser* parser) {
     }
 
     scope->parent = previous_scope;
+    scope->depth  = (previous_scope) ? previous_scope->depth + 1 : 0;
     parser->current_scope = scope;
 
     return scope;
@@ -798,42 +828,14 @@ static void exit_scope(Parser* parser) {
 static Declaration* does_declaration_exist(Declaration* declaration, Scope* scope) {
     assert(declaration && scope);
 
-    List* list = 0;
-    if (declaration->kind == DECLARATION_VARIABLE) {
-        list = &scope->variables;
-    }
-    else if (declaration->kind == DECLARATION_FUNCTION) {
-        list = &scope->functions;
-    }
-    else if (declaration->kind == DECLARATION_TYPE) {
-        list = &scope->types;
-    }
-
-    ListNode* it;
-    list_iterate(it, list) {
-        Declaration* new_decl = list_to_struct(it, Declaration, list_node);
-
-        if (string_compare(&declaration->name, &new_decl->name)) {
-            return new_decl;
-        }
-    }
-
-    return 0;
+    SymbolTable* index = get_declaration_index(scope, declaration->kind);
+    return table_lookup(index, declaration->symbol);
 }
 
 static void push_declaration_on_scope(Declaration* declaration, Scope* scope) {
     assert(declaration && scope);
 
-    List* list = 0;
-    if (declaration->kind == DECLARATION_VARIABLE) {
-        list = &scope->variables;
-    }
-    else if (declaration->kind == DECLARATION_FUNCTION) {
-        list = &scope->functions;
-    }
-    else if (declaration->kind == DECLARATION_TYPE) {
-        list = &scope->types;
-    }
+    List* list = get_declaration_list(scope, declaration->kind);
 
     if (list == 0) {
         printf("Parser (push_declraration) : declaration type not handled\n");
@@ -845,6 +847,7 @@ static void push_declaration_on_scope(Declaration* declaration, Scope* scope) {
     }
 
     list_add_last(&declaration->list_node, list);
+    table_insert(get_declaration_index(scope, declaration->kind), declaration->symbol, declaration);
 }
 
 static void push_declaration_on_current_scope(Declaration* declaration, Parser* parser) {
@@ -857,18 +860,21 @@ static Statement* parse_block(Parser* parser) {
     compound->scope = scope;
 
     Lexer* lexer = parser->lexer;
-    Token* token = current_token(lexer);
+    u32 token = current_token(lexer);
+    u32 first = parser->child_count;
 
-    while (token->kind != TOKEN_END_OF_FILE && token->kind != TOKEN_CLOSE_CURLY) {
+    while (get_token_kind(token) != TOKEN_END_OF_FILE && get_token_kind(token) != TOKEN_CLOSE_CURLY) {
         Statement* statement = try_parse_declaration_or_statement(parser);
 
         if (statement) {
-            list_add_last(&statement->list_node, &compound->statements);
+            push_child(parser, statement);
         }
 
         token = current_token(lexer);
     }
 
+    compound->statements = pop_children(parser, first, ALLOCATION_STATEMENT, &compound->statement_count);
+
     exit_scope(parser);
     return (Statement *)compound;
 }
@@ -883,16 +889,46 @@ static Statement* parse_compound_statement(Parser* parser) {
     return statement;
 }
 
+// Moves past a compound statement by matching the curly brackets, without building anything. If
+// the brackets do not match, the cursor is left where it was, such that the parser can report 
+// the error.
+static bool skim_compound_statement(Parser* parser) {
+    Lexer* lexer = parser->lexer;
+    u32 start = current_token(lexer);
+    u32 token = start;
+    u32 depth = 0;
+
+    if (get_token_kind(token) != TOKEN_OPEN_CURLY) {
+        return false;
+    }
+
+    while (get_token_kind(token) != TOKEN_END_OF_FILE) {
+        if (get_token_kind(token) == TOKEN_OPEN_CURLY) {
+            depth++;
+        }
+        else if (get_token_kind(token) == TOKEN_CLOSE_CURLY && --depth == 0) {
+            next_token(lexer);
+            return true;
+        }
+
+        token = next_token(lexer);
+    }
+
+    seek_token(lexer, start);
+    return false;
+}
+
+void parser_set_skimming(bool is_enabled) {
+    skim_bodies = is_enabled;
+}
+
 Parser* new_parser(Lexer* lexer) {
     Parser* parser = calloc(1, sizeof(Parser));
     parser->lexer = lexer;
-
-    // This must be called prior to using the lexer.
-    next_token(lexer);
     return parser;
 }
 
-static CodeUnit* parser_code_unit(Parser* parser) {
+static void parser_code_unit(Parser* parser, CodeUnit* code_unit) {
     Statement* statement = parse_block(parser);
     assert(statement->kind == STATEMENT_COMPOUND);
     assert(statement->compound.scope->parent == 0);
@@ -905,21 +941,166 @@ static CodeUnit* parser_code_unit(Parser* parser) {
         declaration->is_global = true;
     }
 
+    code_unit->global_scope = statement->compound.scope;
+}
+
+bool is_interface_file(const char* file_name) {
+    return has_extension(file_name, INTERFACE_FILE_EXTENSION);
+}
+
+struct LoadJob {
+    const char** file_names;
+    CodeUnit** code_units;
+};
+
+static void load_code_unit(void* context, u32 index) {
+    struct LoadJob* job = context;
+
     CodeUnit* code_unit = new_code_unit();
+    code_unit->file_name = make_string(job->file_names[index]);
 
-    code_unit->global_scope = statement->compound.scope;
-    code_unit->file_name = parser->lexer->file_name;
+    // We map the entire source file into memory.
+    load_source_file(&code_unit->source, job->file_names[index]);
 
-    return code_unit;
+    if (cache_is_open()) {
+        cache_hash_source(code_unit);
+    }
+
+    // Imported modules are read straight from the mapped interface file, without the terminator.
+    if (is_interface_file(job->file_names[index])) {
+        String data = { .text = code_unit->source.text, .size = code_unit->source.size - 1 };
+
+        if (!read_interface(code_unit, data)) {
+            printf("Interface : %s is not a valid interface file\n", job->file_names[index]);
+            exit(1);
+        }
+
+        code_unit->is_imported = true;
+    }
+
+    job->code_units[index] = code_unit;
 }
 
-Program* parser_program(Parser* parser) {
-    Program* program = new_program();
+void load_code_units(CodeUnit** code_units, const char** file_names, u32 count, ThreadPool* pool) {
+    struct LoadJob job = { .file_names = file_names, .code_units = code_units };
+    thread_pool_run(pool, load_code_unit, &job, count);
+}
+
+// Runs on the thread pool. Each file gets its own lexer and parser, so the only shared state is 
+// the intern table and the arenas, which are both safe to use from any thread.
+static void parse_code_unit(void* context, u32 index) {
+    CodeUnit* code_unit = ((CodeUnit **)context)[index];
+
+    // Cached code units already have a global scope built from the interface.
+    if (code_unit->global_scope) {
+        return;
+    }
+
+    u64 start = trace_time();
+
+    Lexer* lexer   = new_lexer(&code_unit->source, &code_unit->file_name);
+    Parser* parser = new_parser(lexer);
+
+    parser_code_unit(parser, code_unit);
+    trace_event("parse", code_unit->file_name, start);
+
+    free(parser->children);
+    free(parser);
+
+    // The interface must be written before the typer changes the declarations.
+    if (cache_is_open() && !code_unit->has_interface) {
+        OutputBuffer interface;
+        output_init(&interface);
+
+        write_interface(&interface, code_unit);
+        cache_store_interface(code_unit, &interface);
+        output_release(&interface);
+    }
+}
+
+void parse_code_units(CodeUnit** code_units, u32 count, ThreadPool* pool) {
+    thread_pool_run(pool, parse_code_unit, code_units, count);
+}
+
+// Parses the skimmed bodies of one code unit. Functions in the same file share the lexer, so they
+// are parsed one after the other.
+static void parse_function_body(void* context, u32 index) {
+    CodeUnit* code_unit = ((CodeUnit **)context)[index];
+    Parser* parser = 0;
+
+    u64 start = trace_time();
 
-    // Todo: this only parses one file; more specifically the file that is in the parser->lexer. So
-    // this will require more logic.
-    CodeUnit* code_unit = parser_code_unit(parser);
+    ListNode* it;
+    list_iterate(it, &code_unit->global_scope->functions) {
+        Declaration* declaration = list_to_struct(it, Declaration, list_node);
+        Function* function = &declaration->function;
+
+        if (!function->is_skimmed || function->is_unused) {
+            continue;
+        }
+
+        if (parser == 0) {
+            parser = new_parser(get_token_lexer(function->body_start));
+        }
+
+        seek_token(parser->lexer, function->body_start);
+        parser->current_scope = function->function_scope;
+
+        function->body = parse_compound_statement(parser);
+        function->is_skimmed = false;
+    }
+
+    if (parser) {
+        trace_event("parse", code_unit->file_name, start);
+        free(parser->children);
+        free(parser);
+    }
+}
+
+void parse_function_bodies(Program* program, ThreadPool* pool) {
+    u32 count = list_get_size(&program->code_units);
+    CodeUnit** code_units = calloc(count, sizeof(CodeUnit*));
+    u32 index = 0;
+
+    ListNode* it;
+    list_iterate(it, &program->code_units) {
+        code_units[index++] = list_to_struct(it, CodeUnit, list_node);
+    }
+
+    thread_pool_run(pool, parse_function_body, code_units, count);
+    free(code_units);
+}
+
+// Adds the globals of the code unit to the program scope. This runs after all the files are 
+// parsed, in the order the files were given, such that errors are reported deterministically.
+static void link_code_unit(Program* program, CodeUnit* code_unit) {
+    Scope* scope = code_unit->global_scope;
+    List* lists[] = { &scope->variables, &scope->functions, &scope->types };
+
+    for (u32 i = 0; i < 3; i++) {
+        ListNode* it;
+        list_iterate(it, lists[i]) {
+            Declaration* declaration = list_to_struct(it, Declaration, list_node);
+            SymbolTable* index = get_declaration_index(program->global_scope, declaration->kind);
+
+            if (table_lookup(index, declaration->symbol)) {
+                error_token(declaration->name_token, "declaration is existing in another file");
+            }
+
+            table_insert(index, declaration->symbol, declaration);
+        }
+    }
+
+    scope->parent = program->global_scope;
     list_add_last(&code_unit->list_node, &program->code_units);
+}
+
+Program* link_code_units(CodeUnit** code_units, u32 count) {
+    Program* program = new_program();
+
+    for (u32 i = 0; i < count; i++) {
+        link_code_unit(program, code_units[i]);
+    }
 
     return program;
 }
@@ -0,0 +1,110 @@
+// Copyright (C) strawberryhacker.
+//
+// This file finds the functions which the program can reach from its entry point. Only these are
+// parsed, typed and generated, so a program which calls a handful of functions from a big utility
+// file does not pay for the rest of it.
+//
+// The references are found on the tokens of the function bodies instead of the syntax tree, since
+// most bodies are only skimmed by the parser. Every identifier in a body which names a global 
+// function counts as a reference. This may keep a function whose name is shadowed by a local, but
+// it never drops a function which is used, and it also covers assembly bodies and the bodies of 
+// nested functions.
+
+#include <reachability.h>
+#include <lexer.h>
+#include <intern.h>
+#include <stdlib.h>
+
+struct Worklist {
+    Declaration** functions;
+    u32 count;
+    u32 capacity;
+};
+
+static void mark_used(struct Worklist* worklist, Declaration* declaration) {
+    Function* function = &declaration->function;
+    if (!function->is_unused) {
+        return;
+    }
+
+    function->is_unused = false;
+
+    if (worklist->count == worklist->capacity) {
+        worklist->capacity = (worklist->capacity) ? worklist->capacity * 2 : 64;
+        worklist->functions = realloc(worklist->functions, worklist->capacity * sizeof(Declaration*));
+    }
+
+    worklist->functions[worklist->count++] = declaration;
+}
+
+// A function which is unused, but whose body is parsed anyway e.g. by the compile server, gives up 
+// its body, such that the typer does not see it.
+static void drop_body(Function* function) {
+    if (function->body == 0) {
+        return;
+    }
+
+    list_remove(&function->body->compound.scope->list_node);
+    function->body = 0;
+}
+
+void mark_unused_functions(Program* program, bool is_module) {
+    if (is_module) {
+        return;
+    }
+
+    SymbolTable* index = get_declaration_index(program->global_scope, DECLARATION_FUNCTION);
+    struct Worklist worklist = { 0 };
+
+    // Imported functions are never marked, since their code is not part of the program.
+    ListNode* it;
+    list_iterate(it, &program->code_units) {
+        CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
+        if (code_unit->is_imported) {
+            continue;
+        }
+
+        ListNode* function_it;
+        list_iterate(function_it, &code_unit->global_scope->functions) {
+            Declaration* declaration = list_to_struct(function_it, Declaration, list_node);
+            declaration->function.is_unused = true;
+        }
+    }
+
+    String entry_name = make_string("main");
+    Declaration* entry = table_lookup(index, intern_string(&entry_name));
+
+    if (entry) {
+        mark_used(&worklist, entry);
+    }
+
+    while (worklist.count) {
+        Function* function = &worklist.functions[--worklist.count]->function;
+
+        for (u32 token = function->body_start; token < function->body_end; token++) {
+            if (get_token_kind(token) != TOKEN_IDENTIFIER) {
+                continue;
+            }
+
+            Declaration* declaration = table_lookup(index, get_token_symbol(token));
+            if (declaration) {
+                mark_used(&worklist, declaration);
+            }
+        }
+    }
+
+    free(worklist.functions);
+
+    list_iterate(it, &program->code_units) {
+        CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
+
+        ListNode* function_it;
+        list_iterate(function_it, &code_unit->global_scope->functions) {
+            Declaration* declaration = list_to_struct(function_it, Declaration, list_node);
+
+            if (declaration->function.is_unused) {
+                drop_body(&declaration->function);
+            }
+        }
+    }
+}
@@ -0,0 +1,191 @@
+// Copyright (C) strawberryhacker.
+//
+// This file contains the SIMD fast paths for the lexer. Big generated sources are mostly long runs
+// of whitespace, identifiers and comments, and checking these one character at a time is the 
+// slowest part of lexing. Here we compare an entire block against the character classes at once, 
+// and turn the result into a bit mask with one bit per byte.
+//
+// AVX2 is used when the compiler is built with -mavx2, otherwise SSE2 which is always available 
+// on x86-64. Other targets get the scalar fallback, which just leaves the work to the lexer.
+
+// The intrinsic headers must come before types.h, since they use __r and __w as parameter names.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <scan.h>
+
+#if defined(__AVX2__)
+
+#define SCAN_SIMD
+#define BLOCK_SIZE 32
+
+typedef __m256i Block;
+
+static inline Block load_block(const char* data) { return _mm256_loadu_si256((const __m256i *)data); }
+static inline Block splat(char c)                { return _mm256_set1_epi8(c); }
+static inline Block equal(Block a, Block b)      { return _mm256_cmpeq_epi8(a, b); }
+static inline Block either(Block a, Block b)     { return _mm256_or_si256(a, b); }
+static inline Block minimum(Block a, Block b)    { return _mm256_min_epu8(a, b); }
+static inline Block subtract(Block a, Block b)   { return _mm256_sub_epi8(a, b); }
+static inline u32 to_mask(Block block)           { return (u32)_mm256_movemask_epi8(block); }
+
+#elif defined(__SSE2__)
+
+#define SCAN_SIMD
+#define BLOCK_SIZE 16
+
+typedef __m128i Block;
+
+static inline Block load_block(const char* data) { return _mm_loadu_si128((const __m128i *)data); }
+static inline Block splat(char c)                { return _mm_set1_epi8(c); }
+static inline Block equal(Block a, Block b)      { return _mm_cmpeq_epi8(a, b); }
+static inline Block either(Block a, Block b)     { return _mm_or_si128(a, b); }
+static inline Block minimum(Block a, Block b)    { return _mm_min_epu8(a, b); }
+static inline Block subtract(Block a, Block b)   { return _mm_sub_epi8(a, b); }
+static inline u32 to_mask(Block block)           { return (u32)_mm_movemask_epi8(block); }
+
+#endif
+
+#ifdef SCAN_SIMD
+
+#define FULL_MASK ((u32)((1ull << BLOCK_SIZE) - 1))
+
+// Bytes in the range [low, low + count) are marked.
+static inline Block in_range(Block block, char low, u8 count) {
+    Block offset = subtract(block, splat(low));
+    return equal(minimum(offset, splat(count - 1)), offset);
+}
+
+static inline u32 whitespace_mask(Block block) {
+    Block space = either(equal(block, splat(' ')), equal(block, splat('\t')));
+    Block lines = either(equal(block, splat('\n')), equal(block, splat('\r')));
+    return to_mask(either(space, lines));
+}
+
+static inline u32 identifier_mask(Block block) {
+    // Setting bit 5 converts upper-case to lower-case, just like in the lexer.
+    Block lower   = either(block, splat(1 << 5));
+    Block letters = in_range(lower, 'a', 26);
+    Block digits  = in_range(block, '0', 10);
+    return to_mask(either(either(letters, digits), equal(block, splat('_'))));
+}
+
+// Returns the number of bytes before the first zero bit in the masks produced by 'mask_function'.
+#define SCAN_RUN(start, end, mask_function)                             \
+    do {                                                                \
+        const char* cursor = start;                                     \
+        while (end - cursor >= BLOCK_SIZE) {                            \
+            u32 mask = ~mask_function(load_block(cursor)) & FULL_MASK;  \
+            if (mask) {                                                 \
+                return (cursor - start) + __builtin_ctz(mask);          \
+            }                                                           \
+            cursor += BLOCK_SIZE;                                       \
+        }                                                               \
+        return cursor - start;                                          \
+    } while (0)
+
+u32 scan_whitespace(const char* start, const char* end) {
+    SCAN_RUN(start, end, whitespace_mask);
+}
+
+u32 scan_identifier(const char* start, const char* end) {
+    SCAN_RUN(start, end, identifier_mask);
+}
+
+u32 scan_until(const char* start, const char* end, char a, char b, char c) {
+    Block block_a = splat(a);
+    Block block_b = splat(b);
+    Block block_c = splat(c);
+
+    const char* cursor = start;
+    while (end - cursor >= BLOCK_SIZE) {
+        Block block = load_block(cursor);
+        u32 mask = to_mask(either(either(equal(block, block_a), equal(block, block_b)), equal(block, block_c)));
+
+        if (mask) {
+            return (cursor - start) + __builtin_ctz(mask);
+        }
+
+        cursor += BLOCK_SIZE;
+    }
+
+    return cursor - start;
+}
+
+u32 find_line_breaks(const char* start, u32 size, u32* breaks) {
+    u32 count = 0;
+
+    // A '\r' is only a line break on its own if the next byte is not a '\n'. Comparing the block 
+    // loaded one byte ahead gives us the next byte for every position. The span is always followed
+    // by at least the zero terminator, so the shifted load stays inside the file.
+    u32 offset = 0;
+    while (size - offset >= BLOCK_SIZE) {
+        Block block = load_block(start + offset);
+        Block next  = load_block(start + offset + 1);
+
+        u32 newlines = to_mask(equal(block, splat('\n')));
+        u32 returns  = to_mask(equal(block, splat('\r'))) & ~to_mask(equal(next, splat('\n')));
+        u32 mask     = newlines | returns;
+
+        if (breaks) {
+            while (mask) {
+                breaks[count++] = offset + __builtin_ctz(mask);
+                mask &= mask - 1;
+            }
+        }
+        else {
+            count += __builtin_popcount(mask);
+        }
+
+        offset += BLOCK_SIZE;
+    }
+
+    for (; offset < size; offset++) {
+        char c = start[offset];
+        if (c == '\n' || (c == '\r' && start[offset + 1] != '\n')) {
+            if (breaks) {
+                breaks[count] = offset;
+            }
+
+            count++;
+        }
+    }
+
+    return count;
+}
+
+#else
+
+u32 scan_whitespace(const char* start, const char* end) {
+    return 0;
+}
+
+u32 scan_identifier(const char* start, const char* end) {
+    return 0;
+}
+
+u32 scan_until(const char* start, const char* end, char a, char b, char c) {
+    return 0;
+}
+
+u32 find_line_breaks(const char* start, u32 size, u32* breaks) {
+    u32 count = 0;
+
+    for (u32 offset = 0; offset < size; offset++) {
+        char c = start[offset];
+        if (c == '\n' || (c == '\r' && start[offset + 1] != '\n')) {
+            if (breaks) {
+                breaks[count] = offset;
+            }
+
+            count++;
+        }
+    }
+
+    return count;
+}
+
+#endif
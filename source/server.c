@@ -0,0 +1,638 @@
+// Copyright (C) strawberryhacker.
+//
+// This file implements the compile server. The server listens on a Unix socket, and keeps the 
+// code units it has compiled parsed in memory. A request is the working directory and the command
+// line of the client. Files whose source did not change since the last request are not lexed or 
+// parsed again, only typed and generated.
+//
+// The resident code units are parsed, but never typed. Typing resolves the names of one file to 
+// the declarations of the others and rewrites the trees in place, so a typed code unit is only 
+// valid for as long as every file it uses is unchanged. Every request therefore types the whole 
+// program again, and only lexing and parsing is saved for the unchanged files. Requests given 
+// --cache skip the typing of unchanged files as well, since the cached interfaces of the 
+// unchanged code units replace their trees.
+//
+// Every request is compiled in a forked child, which gets its own copy on write view of the 
+// resident trees, the arenas and the intern table. Whatever the compilation does to them is thrown
+// away when the child exits. This also keeps the server alive when the compilation fails, since 
+// errors exit the process.
+//
+// The child writes everything it prints to the connection, followed by a single byte with the 
+// exit status. Once a compilation succeeds, the server parses the changed files itself, such that
+// the next request can use them. The server parses the exact bytes the child compiled, and it 
+// skims the function bodies exactly when the child did. A --reachable request never parses the 
+// bodies of the functions which are not used, so the server must not do it either, since a syntax
+// error in them would take the server down. The skimmed bodies of a resident file are parsed by 
+// every later request which is not --reachable, and the file is parsed in full once one of them 
+// succeeds.
+//
+// The interned names and the tokens point into the sources, and the tree nodes of all the files 
+// share the parse arenas, so a replaced code unit can not be released on its own. It is retired
+// instead, and once the retired sources outgrow the resident ones, the server releases everything
+// and parses the resident files again. This keeps the memory and the token pages of a long running
+// server proportional to the files it keeps.
+
+#define _DEFAULT_SOURCE
+#include <server.h>
+#include <compile.h>
+#include <parser.h>
+#include <source.h>
+#include <cache.h>
+#include <thread_pool.h>
+#include <intern.h>
+#include <lexer.h>
+#include <arena.h>
+#include <table.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+#define REQUEST_CHUNK_SIZE (1 << 12)
+
+// Seconds a file must have been left alone before the server trusts its status, see below.
+#define MODIFICATION_TIME_SLACK 2
+
+// A parsed file kept between the requests.
+struct ResidentFile {
+    CodeUnit* code_unit;
+
+    // The absolute path of the file, interned.
+    u32 path;
+
+    // Set when the function bodies were skimmed, because the file came from a --reachable request.
+    bool is_skimmed;
+
+    // Status of the file when the source was last found to be the same, and when that was.
+    struct stat status;
+    struct timespec check_time;
+};
+
+// State of one input file of the request being served.
+struct RequestFile {
+    // The absolute path of the file, interned.
+    u32 path;
+    struct stat status;
+    struct timespec check_time;
+
+    // Set when the file did not change since it was parsed.
+    struct ResidentFile* resident;
+
+    // Otherwise the source which is compiled, and parsed by the server afterwards.
+    String source;
+};
+
+// A replaced code unit, whose source and file name are released when the server starts over.
+struct RetiredFile {
+    String source;
+    char* file_name;
+};
+
+// Maps the interned absolute path of a file to its resident file.
+static SymbolTable resident_files;
+
+static struct ResidentFile** residents;
+static u32 resident_count;
+static u64 resident_size;
+
+static struct RetiredFile* retired_files;
+static u32 retired_count;
+static u64 retired_size;
+
+// The texts of the interned paths, which are released when the server starts over.
+static char** path_texts;
+static u32 path_count;
+
+static struct RequestFile* request_files;
+
+static void keep_path_text(char* text) {
+    path_texts = realloc(path_texts, (path_count + 1) * sizeof(char*));
+    path_texts[path_count++] = text;
+}
+
+// Interns the absolute path of an input file. The path must outlive the symbol, so the text of a 
+// new path is kept until the server starts over.
+static u32 intern_path(const char* directory, const char* name) {
+    String path;
+    path.size = make_string(name).size;
+
+    if (name[0] != '/') {
+        path.size += make_string(directory).size + 1;
+    }
+
+    path.text = malloc(path.size + 1);
+    snprintf(path.text, path.size + 1, (name[0] == '/') ? "%s%s" : "%s/%s", (name[0] == '/') ? "" : directory, name);
+
+    u32 symbol = intern_string(&path);
+    if (get_symbol_name(symbol)->text != path.text) {
+        free(path.text);
+    }
+    else {
+        keep_path_text(path.text);
+    }
+
+    return symbol;
+}
+
+static bool is_same_source(String* a, String* b) {
+    return a->size == b->size && __builtin_memcmp(a->text, b->text, a->size) == 0;
+}
+
+// A file is only trusted to be unchanged based on its status if it was not modified shortly before
+// it was checked. The modification time is coarse, and may even be rounded down to whole seconds, 
+// so a write right after the check could otherwise leave the same status behind.
+static bool is_same_status(struct ResidentFile* resident, struct stat* status) {
+    struct stat* old = &resident->status;
+
+    if (old->st_dev != status->st_dev || old->st_ino != status->st_ino || old->st_size != status->st_size) {
+        return false;
+    }
+
+    if (old->st_mtim.tv_sec != status->st_mtim.tv_sec || old->st_mtim.tv_nsec != status->st_mtim.tv_nsec) {
+        return false;
+    }
+
+    return old->st_mtim.tv_sec + MODIFICATION_TIME_SLACK < resident->check_time.tv_sec;
+}
+
+// Looks for the input files which are already parsed, and loads a copy of the other ones.
+static void prepare_request(Options* options, const char* directory) {
+    request_files = calloc(options->input_count, sizeof(struct RequestFile));
+
+    for (u32 i = 0; i < options->input_count; i++) {
+        const char* name = options->input_files[i];
+        struct RequestFile* file = &request_files[i];
+
+        // The compilation reads stdin and the interface files itself.
+        if ((name[0] == '-' && name[1] == 0) || is_interface_file(name)) {
+            continue;
+        }
+
+        file->path = intern_path(directory, name);
+        const char* path = get_symbol_name(file->path)->text;
+
+        // Missing files are reported by the compilation.
+        clock_gettime(CLOCK_REALTIME, &file->check_time);
+        if (stat(path, &file->status)) {
+            continue;
+        }
+
+        // The file name is part of the code unit, so the file must be given by the same name.
+        struct ResidentFile* resident = table_lookup(&resident_files, file->path);
+        String file_name = make_string(name);
+
+        if (resident && !string_compare(&resident->code_unit->file_name, &file_name)) {
+            resident = 0;
+        }
+
+        if (resident && is_same_status(resident, &file->status)) {
+            file->resident = resident;
+            continue;
+        }
+
+        if (!load_source_copy(&file->source, path)) {
+            continue;
+        }
+
+        if (resident && is_same_source(&file->source, &resident->code_unit->source)) {
+            unload_source_file(&file->source);
+            file->resident = resident;
+
+            resident->status = file->status;
+            resident->check_time = file->check_time;
+        }
+    }
+}
+
+// Runs in the child instead of load_code_units. Unchanged files are replaced by the resident code
+// units, and the changed files use the copies which the server parses afterwards, in case the 
+// files are written to in the meantime.
+//
+// With a cache, unchanged files are left to the cache like in a regular compilation. Their 
+// interface and output are cached already, and the cache needs the interface hash of every code 
+// unit, which the resident code units do not have.
+static void load_request_files(CodeUnit** code_units, const char** file_names, u32 count, ThreadPool* pool) {
+    for (u32 i = 0; i < count; i++) {
+        struct RequestFile* file = &request_files[i];
+
+        if (file->resident && !cache_is_open()) {
+            code_units[i] = file->resident->code_unit;
+            continue;
+        }
+
+        if (file->resident == 0 && file->source.text == 0) {
+            // Stdin, interface files and missing files are loaded the regular way.
+            load_code_units(&code_units[i], &file_names[i], 1, pool);
+            continue;
+        }
+
+        CodeUnit* code_unit = new_code_unit();
+        code_unit->file_name = make_string(file_names[i]);
+        code_unit->source = (file->resident) ? file->resident->code_unit->source : file->source;
+
+        if (cache_is_open()) {
+            cache_hash_source(code_unit);
+        }
+
+        code_units[i] = code_unit;
+    }
+}
+
+static void run_compilation(int connection, Options* options, bool is_valid, const char* directory) {
+    int null = open("/dev/null", O_RDONLY);
+    if (chdir(directory) || null < 0) {
+        exit(1);
+    }
+
+    dup2(null, STDIN_FILENO);
+    dup2(connection, STDOUT_FILENO);
+    dup2(connection, STDERR_FILENO);
+    close(connection);
+    close(null);
+
+    if (!is_valid) {
+        print_usage();
+        exit(1);
+    }
+
+    compile(options, load_request_files);
+    exit(0);
+}
+
+// A code unit which is parsed again from the same source keeps the source and the file name.
+static void retire_code_unit(CodeUnit* code_unit, bool keeps_source) {
+    retired_files = realloc(retired_files, (retired_count + 1) * sizeof(struct RetiredFile));
+    retired_files[retired_count] = (struct RetiredFile){ code_unit->source, code_unit->file_name.text };
+
+    if (keeps_source) {
+        retired_files[retired_count] = (struct RetiredFile){ 0 };
+    }
+
+    retired_count++;
+
+    retired_size  += code_unit->source.size;
+    resident_size -= code_unit->source.size;
+}
+
+static void parse_resident_code_units(CodeUnit** code_units, u32 count, bool is_skimmed) {
+    // The pool only lives while parsing, such that the server has a single thread when it forks.
+    if (count) {
+        ThreadPool* pool = new_thread_pool(get_processor_count());
+        parser_set_skimming(is_skimmed);
+        parse_code_units(code_units, count, pool);
+        parser_set_skimming(false);
+        free_thread_pool(pool);
+    }
+}
+
+// Releases the retired files along with everything the server has parsed, and parses the resident
+// files again. The paths of the resident files are the only names which are interned again.
+static void start_over() {
+    String* sources    = malloc(resident_count * sizeof(String));
+    String* file_names = malloc(resident_count * sizeof(String));
+    char** paths       = malloc(resident_count * sizeof(char*));
+
+    // The code units live in the arenas, and the path texts are released below.
+    for (u32 i = 0; i < resident_count; i++) {
+        String* path = get_symbol_name(residents[i]->path);
+
+        paths[i] = malloc(path->size + 1);
+        __builtin_memcpy(paths[i], path->text, path->size);
+        paths[i][path->size] = 0;
+
+        sources[i]    = residents[i]->code_unit->source;
+        file_names[i] = residents[i]->code_unit->file_name;
+    }
+
+    for (u32 i = 0; i < retired_count; i++) {
+        unload_source_file(&retired_files[i].source);
+        free(retired_files[i].file_name);
+    }
+
+    for (u32 i = 0; i < path_count; i++) {
+        free(path_texts[i]);
+    }
+
+    free(retired_files);
+    retired_files = 0;
+    retired_count = 0;
+    retired_size  = 0;
+
+    free(path_texts);
+    path_texts = 0;
+    path_count = 0;
+
+    arena_release_all();
+    release_token_pages();
+    release_intern_table();
+    resident_files = (SymbolTable){ 0 };
+
+    // The skimmed files go first, such that each half is parsed in its own mode.
+    CodeUnit** code_units = calloc(resident_count, sizeof(CodeUnit*));
+    u32 skimmed_count = 0;
+
+    for (u32 i = 0; i < resident_count; i++) {
+        skimmed_count += residents[i]->is_skimmed;
+    }
+
+    u32 skimmed_index = 0;
+    u32 parsed_index  = skimmed_count;
+
+    for (u32 i = 0; i < resident_count; i++) {
+        struct ResidentFile* resident = residents[i];
+        String path = make_string(paths[i]);
+
+        keep_path_text(paths[i]);
+        resident->path = intern_string(&path);
+        table_insert(&resident_files, resident->path, resident);
+
+        CodeUnit* code_unit = new_code_unit();
+        code_unit->file_name = file_names[i];
+        code_unit->source    = sources[i];
+
+        resident->code_unit = code_unit;
+        code_units[(resident->is_skimmed) ? skimmed_index++ : parsed_index++] = code_unit;
+    }
+
+    parse_resident_code_units(code_units, skimmed_count, true);
+    parse_resident_code_units(code_units + skimmed_count, resident_count - skimmed_count, false);
+
+    free(code_units);
+    free(paths);
+    free(file_names);
+    free(sources);
+}
+
+// Parses the files which changed, and makes them resident. The replaced code units are retired, 
+// since the interned names and the tokens may still point into them.
+static void keep_changed_files(Options* options) {
+    u32 count = 0;
+    CodeUnit** code_units = calloc(options->input_count, sizeof(CodeUnit*));
+    bool is_skimmed = options->reachable_only;
+
+    for (u32 i = 0; i < options->input_count; i++) {
+        struct RequestFile* file = &request_files[i];
+
+        // A request which is not --reachable has parsed the skimmed bodies of the resident files,
+        // so they can be parsed in full.
+        if (file->resident && file->resident->is_skimmed && !is_skimmed) {
+            struct ResidentFile* resident = file->resident;
+            retire_code_unit(resident->code_unit, true);
+
+            CodeUnit* code_unit = new_code_unit();
+            code_unit->file_name = resident->code_unit->file_name;
+            code_unit->source    = resident->code_unit->source;
+
+            resident->code_unit  = code_unit;
+            resident->is_skimmed = false;
+            resident_size += code_unit->source.size;
+            code_units[count++] = code_unit;
+            continue;
+        }
+
+        if (file->resident || file->source.text == 0) {
+            continue;
+        }
+
+        struct ResidentFile* resident = table_lookup(&resident_files, file->path);
+        if (resident == 0) {
+            resident = malloc(sizeof(struct ResidentFile));
+            resident->path = file->path;
+            table_insert(&resident_files, file->path, resident);
+
+            residents = realloc(residents, (resident_count + 1) * sizeof(struct ResidentFile*));
+            residents[resident_count++] = resident;
+        }
+        else {
+            retire_code_unit(resident->code_unit, false);
+        }
+
+        // The file name is taken from the request, which is released.
+        String name = make_string(options->input_files[i]);
+        char* name_copy = malloc(name.size + 1);
+        __builtin_memcpy(name_copy, name.text, name.size + 1);
+
+        // The server stays in the parse phase, so the code units go into the parse arenas.
+        CodeUnit* code_unit = new_code_unit();
+        code_unit->file_name = (String){ .text = name_copy, .size = name.size };
+        code_unit->source = file->source;
+
+        resident->code_unit = code_unit;
+        resident->is_skimmed = is_skimmed;
+        resident->status = file->status;
+        resident->check_time = file->check_time;
+        resident_size += code_unit->source.size;
+        code_units[count++] = code_unit;
+    }
+
+    // Starting over parses every resident file, so it costs about as much as the retired files 
+    // did, and the time spent on it stays proportional to the edits.
+    if (retired_size > resident_size) {
+        start_over();
+    }
+    else {
+        parse_resident_code_units(code_units, count, is_skimmed);
+    }
+
+    free(code_units);
+}
+
+static void release_request(Options* options, bool is_compiled) {
+    for (u32 i = 0; i < options->input_count; i++) {
+        struct RequestFile* file = &request_files[i];
+
+        if (!is_compiled && file->source.text) {
+            unload_source_file(&file->source);
+        }
+    }
+
+    free(request_files);
+    request_files = 0;
+}
+
+// Reads the request until the client shuts down its side of the connection. The request is a 
+// list of zero terminated strings.
+static char* read_request(int connection, u32* size) {
+    u32 capacity = REQUEST_CHUNK_SIZE;
+    char* data = malloc(capacity);
+    *size = 0;
+
+    while (1) {
+        if (*size == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+
+        ssize_t count = read(connection, data + *size, capacity - *size);
+        if (count <= 0) {
+            return (count == 0) ? data : (free(data), (char *)0);
+        }
+
+        *size += count;
+    }
+}
+
+static void serve_request(int connection) {
+    u32 size;
+    char* data = read_request(connection, &size);
+    if (data == 0 || size == 0 || data[size - 1] != 0) {
+        free(data);
+        return;
+    }
+
+    // The first string is the working directory, and the rest is the command line.
+    u32 argument_count = 0;
+    char** arguments = malloc(size * sizeof(char *));
+
+    for (u32 i = 0; i < size; i += make_string(data + i).size + 1) {
+        arguments[argument_count++] = data + i;
+    }
+
+    const char* directory = arguments[0];
+
+    Options options;
+    bool is_valid = parse_options(&options, argument_count - 1, arguments + 1);
+    if (is_valid) {
+        prepare_request(&options, directory);
+    }
+
+    // Nothing buffered in the server may end up in the child.
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        run_compilation(connection, &options, is_valid, directory);
+    }
+
+    u8 status = 1;
+    int wait_status;
+
+    if (pid > 0 && waitpid(pid, &wait_status, 0) == pid && WIFEXITED(wait_status)) {
+        status = WEXITSTATUS(wait_status);
+    }
+
+    // The client is done once it has the status, so it is let go before the files are parsed.
+    write(connection, &status, 1);
+    shutdown(connection, SHUT_WR);
+
+    if (is_valid) {
+        if (status == 0) {
+            keep_changed_files(&options);
+        }
+
+        release_request(&options, status == 0);
+    }
+
+    free(arguments);
+    free(data);
+}
+
+static void fill_address(struct sockaddr_un* address, const char* socket_path) {
+    if (make_string(socket_path).size >= sizeof(address->sun_path)) {
+        printf("Server : the socket path %s is too long\n", socket_path);
+        exit(1);
+    }
+
+    *address = (struct sockaddr_un){ .sun_family = AF_UNIX };
+    __builtin_memcpy(address->sun_path, socket_path, make_string(socket_path).size + 1);
+}
+
+void run_server(const char* socket_path) {
+    struct sockaddr_un address;
+    fill_address(&address, socket_path);
+
+    // Clients which go away must not take the server with them.
+    signal(SIGPIPE, SIG_IGN);
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path);
+
+    if (server < 0 || bind(server, (struct sockaddr *)&address, sizeof(address)) || listen(server, 16)) {
+        printf("Server : cannot listen on %s\n", socket_path);
+        exit(1);
+    }
+
+    printf("Server : listening on %s\n", socket_path);
+    fflush(stdout);
+
+    // Requests are served one at a time, since every request may change the resident files.
+    while (1) {
+        int connection = accept(server, 0, 0);
+        if (connection < 0) {
+            continue;
+        }
+
+        serve_request(connection);
+        close(connection);
+    }
+}
+
+static void write_all(int fd, const char* data, u32 size) {
+    while (size) {
+        ssize_t count = write(fd, data, size);
+        if (count <= 0) {
+            printf("Server : write failed\n");
+            exit(1);
+        }
+
+        data += count;
+        size -= count;
+    }
+}
+
+void run_client(const char* socket_path, int argument_count, char** arguments) {
+    struct sockaddr_un address;
+    fill_address(&address, socket_path);
+
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0 || connect(connection, (struct sockaddr *)&address, sizeof(address))) {
+        printf("Server : cannot connect to %s\n", socket_path);
+        exit(1);
+    }
+
+    char directory[4096];
+    if (getcwd(directory, sizeof(directory)) == 0) {
+        printf("Server : cannot get the working directory\n");
+        exit(1);
+    }
+
+    write_all(connection, directory, make_string(directory).size + 1);
+    for (int i = 0; i < argument_count; i++) {
+        write_all(connection, arguments[i], make_string(arguments[i]).size + 1);
+    }
+
+    shutdown(connection, SHUT_WR);
+
+    // The last byte is the exit status, so one byte is always held back.
+    char buffer[REQUEST_CHUNK_SIZE];
+    bool has_status = false;
+    char status = 0;
+
+    while (1) {
+        ssize_t count = read(connection, buffer, sizeof(buffer));
+        if (count <= 0) {
+            break;
+        }
+
+        if (has_status) {
+            write_all(STDOUT_FILENO, &status, 1);
+        }
+
+        write_all(STDOUT_FILENO, buffer, count - 1);
+        status = buffer[count - 1];
+        has_status = true;
+    }
+
+    if (!has_status) {
+        printf("Server : the server closed the connection\n");
+        exit(1);
+    }
+
+    exit((u8)status);
+}
@@ -0,0 +1,172 @@
+// Copyright (C) strawberryhacker.
+//
+// This file is responsible for getting the source files into memory. Big files are mapped 
+// directly from the page cache instead of being copied into a private buffer, which saves both 
+// the copy and the duplicated memory.
+//
+// The lexer depends on a zero terminator after the source. A file mapping can not be extended, so
+// we first reserve an anonymous (zero filled) mapping of the file size plus one extra page, and 
+// then map the file on top of it. The bytes between the end of the file and the end of its last 
+// page are zero filled by the kernel, and if the file ends exactly on a page boundary the extra 
+// anonymous page provides the terminator. The reservation ends with a guard page without any 
+// access, so reading past the terminator faults instead of silently reading another mapping.
+
+#define _DEFAULT_SOURCE
+#include <source.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define STREAM_CHUNK_SIZE (1 << 16)
+
+// Distinguishes mapped sources from heap sources when unloading.
+struct LoadedSource {
+    char* text;
+    u64 size;
+    bool is_mapped;
+};
+
+static struct LoadedSource* loaded_sources;
+static u32 loaded_count;
+
+// Source files are loaded from the parser threads.
+static pthread_mutex_t source_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void remember_source(char* text, u64 size, bool is_mapped) {
+    pthread_mutex_lock(&source_lock);
+    loaded_sources = realloc(loaded_sources, (loaded_count + 1) * sizeof(struct LoadedSource));
+    loaded_sources[loaded_count++] = (struct LoadedSource){ text, size, is_mapped };
+    pthread_mutex_unlock(&source_lock);
+}
+
+static void stream_source_file(String* source, int fd) {
+    u64 capacity = STREAM_CHUNK_SIZE;
+    u64 size = 0;
+    char* text = malloc(capacity);
+
+    while (1) {
+        // Always leave room for the terminator.
+        if (size + 1 >= capacity) {
+            capacity *= 2;
+            text = realloc(text, capacity);
+        }
+
+        if (text == 0) {
+            printf("Source : out of memory\n");
+            exit(1);
+        }
+
+        ssize_t count = read(fd, text + size, capacity - size - 1);
+        if (count < 0) {
+            printf("Source : read failed\n");
+            exit(1);
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        size += count;
+    }
+
+    text[size] = 0;
+
+    source->text = text;
+    source->size = size + 1;
+
+    remember_source(text, size + 1, false);
+}
+
+static bool map_source_file(String* source, int fd, u64 file_size) {
+    u64 page_size = sysconf(_SC_PAGESIZE);
+    u64 map_size  = ((file_size + page_size - 1) & ~(page_size - 1)) + 2 * page_size;
+
+    char* base = mmap(0, map_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    if (mprotect(base + map_size - page_size, page_size, PROT_NONE)) {
+        munmap(base, map_size);
+        return false;
+    }
+
+    if (file_size) {
+        void* file = mmap(base, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (file == MAP_FAILED) {
+            munmap(base, map_size);
+            return false;
+        }
+
+        // The lexer walks the file from start to end.
+        madvise(base, file_size, MADV_SEQUENTIAL);
+    }
+
+    source->text = base;
+    source->size = file_size + 1;
+
+    remember_source(base, map_size, true);
+    return true;
+}
+
+void load_source_file(String* source, const char* file_name) {
+    bool is_stdin = (file_name[0] == '-' && file_name[1] == 0);
+    int fd = (is_stdin) ? STDIN_FILENO : open(file_name, O_RDONLY);
+
+    if (fd < 0) {
+        printf("Source : cannot open %s\n", file_name);
+        exit(1);
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) || !S_ISREG(status.st_mode) || !map_source_file(source, fd, status.st_size)) {
+        // Pipes and other special files can not be mapped.
+        stream_source_file(source, fd);
+    }
+
+    if (!is_stdin) {
+        close(fd);
+    }
+}
+
+bool load_source_copy(String* source, const char* file_name) {
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    stream_source_file(source, fd);
+    close(fd);
+    return true;
+}
+
+void unload_source_file(String* source) {
+    pthread_mutex_lock(&source_lock);
+
+    for (u32 i = 0; i < loaded_count; i++) {
+        struct LoadedSource* loaded = &loaded_sources[i];
+
+        if (loaded->text != source->text) {
+            continue;
+        }
+
+        if (loaded->is_mapped) {
+            munmap(loaded->text, loaded->size);
+        }
+        else {
+            free(loaded->text);
+        }
+
+        loaded_sources[i] = loaded_sources[--loaded_count];
+        break;
+    }
+
+    pthread_mutex_unlock(&source_lock);
+
+    source->text = 0;
+    source->size = 0;
+}
@@ -16,3 +16,25 @@ bool string_compare(String* a, String* b) {
 
     return true;
 }
+
+bool has_extension(const char* file_name, const char* extension) {
+    String name = make_string(file_name);
+    String suffix = make_string(extension);
+
+    if (name.size < suffix.size) {
+        return false;
+    }
+
+    name.text += name.size - suffix.size;
+    name.size  = suffix.size;
+    return string_compare(&name, &suffix);
+}
+
+String make_string(const char* text) {
+    u32 size = 0;
+    while (text[size]) {
+        size++;
+    }
+
+    return (String){ .text = (char *)text, .size = size };
+}
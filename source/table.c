@@ -0,0 +1,81 @@
+// Copyright (C) strawberryhacker.
+//
+// Open addressing hash table with linear probing, used for all symbol indexes in the compiler. 
+// Keys are already well distributed dense IDs, so they are only mixed lightly before probing.
+
+#include <table.h>
+#include <arena.h>
+
+#define TABLE_INITIAL_CAPACITY 8
+
+static inline u32 hash_key(u32 key) {
+    return key * 2654435761u;
+}
+
+static void place_entry(SymbolEntry* entries, u32 capacity, u32 key, void* value) {
+    u32 mask  = capacity - 1;
+    u32 index = hash_key(key) & mask;
+
+    while (entries[index].key && entries[index].key != key) {
+        index = (index + 1) & mask;
+    }
+
+    entries[index].key   = key;
+    entries[index].value = value;
+}
+
+static void grow_table(SymbolTable* table) {
+    u32 capacity = (table->capacity) ? table->capacity * 2 : TABLE_INITIAL_CAPACITY;
+    SymbolEntry* entries = phase_allocate(ALLOCATION_SYMBOL_TABLE, capacity * sizeof(SymbolEntry));
+
+    for (u32 i = 0; i < table->capacity; i++) {
+        if (table->entries[i].key) {
+            place_entry(entries, capacity, table->entries[i].key, table->entries[i].value);
+        }
+    }
+
+    table->entries  = entries;
+    table->capacity = capacity;
+}
+
+void* table_lookup(SymbolTable* table, u32 key) {
+    if (table->count == 0) {
+        return 0;
+    }
+
+    u32 mask  = table->capacity - 1;
+    u32 index = hash_key(key) & mask;
+
+    while (table->entries[index].key) {
+        if (table->entries[index].key == key) {
+            return table->entries[index].value;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    return 0;
+}
+
+void table_insert(SymbolTable* table, u32 key, void* value) {
+    // Keep the load factor below three quarters.
+    if (4 * (table->count + 1) > 3 * table->capacity) {
+        grow_table(table);
+    }
+
+    u32 mask  = table->capacity - 1;
+    u32 index = hash_key(key) & mask;
+
+    while (table->entries[index].key) {
+        if (table->entries[index].key == key) {
+            table->entries[index].value = value;
+            return;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    table->entries[index].key   = key;
+    table->entries[index].value = value;
+    table->count++;
+}
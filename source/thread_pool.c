@@ -0,0 +1,147 @@
+// Copyright (C) strawberryhacker.
+//
+// This file implements the thread pool used by the parallel phases of the compiler. The work is 
+// always a parallel loop over a known number of items (files, functions, ...), so instead of a 
+// task queue the threads just grab the next index from a shared counter until the range is empty.
+
+#define _DEFAULT_SOURCE
+#include <thread_pool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static _Thread_local u32 thread_index;
+
+struct Worker {
+    ThreadPool* pool;
+    u32 index;
+};
+
+static void run_tasks(ThreadPool* pool) {
+    while (1) {
+        u32 index = __atomic_fetch_add(&pool->next_index, 1, __ATOMIC_RELAXED);
+        if (index >= pool->task_count) {
+            break;
+        }
+
+        pool->task(pool->context, index);
+    }
+}
+
+static void* worker_main(void* argument) {
+    struct Worker* worker = argument;
+    ThreadPool* pool = worker->pool;
+    thread_index = worker->index;
+    free(worker);
+
+    u32 generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->generation == generation && !pool->stop) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+
+        if (pool->stop) {
+            break;
+        }
+
+        generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_tasks(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy_workers == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+ThreadPool* new_thread_pool(u32 thread_count) {
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+
+    pool->thread_count = thread_count;
+    pool->threads = calloc(thread_count, sizeof(pthread_t));
+
+    pthread_mutex_init(&pool->lock, 0);
+    pthread_cond_init(&pool->work_ready, 0);
+    pthread_cond_init(&pool->work_done, 0);
+
+    // Thread zero is the caller.
+    for (u32 i = 1; i < thread_count; i++) {
+        struct Worker* worker = malloc(sizeof(struct Worker));
+        worker->pool  = pool;
+        worker->index = i;
+
+        if (pthread_create(&pool->threads[i], 0, worker_main, worker)) {
+            printf("Thread pool : cannot create thread\n");
+            exit(1);
+        }
+    }
+
+    return pool;
+}
+
+void free_thread_pool(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (u32 i = 1; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], 0);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+
+    free(pool->threads);
+    free(pool);
+}
+
+void thread_pool_run(ThreadPool* pool, Task task, void* context, u32 count) {
+    if (pool->thread_count == 1 || count <= 1) {
+        for (u32 i = 0; i < count; i++) {
+            task(context, i);
+        }
+
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task         = task;
+    pool->context      = context;
+    pool->task_count   = count;
+    pool->next_index   = 0;
+    pool->busy_workers = pool->thread_count - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_tasks(pool);
+
+    // Every worker takes part in every loop, so none of them can still be reading the loop state
+    // when the next one is set up.
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy_workers) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+u32 get_thread_index() {
+    return thread_index;
+}
+
+u32 get_processor_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? count : 1;
+}
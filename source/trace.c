@@ -0,0 +1,308 @@
+// Copyright (C) strawberryhacker.
+//
+// This file records timed events for the compiler phases and the work items inside them. Every
+// thread appends to its own event buffer, so timing a parallel loop does not add any contention.
+// The buffers are only read once the compilation is done.
+
+#include <trace.h>
+#include <thread_pool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+// Number of items listed for each category in the summary.
+#define TRACE_SUMMARY_COUNT 10
+
+struct TraceEvent {
+    const char* category;
+    String name;
+    u64 start;
+    u64 duration;
+    u32 thread;
+};
+
+struct TraceBuffer {
+    struct TraceBuffer* next;
+    struct TraceEvent* events;
+    u32 count;
+    u32 capacity;
+};
+
+// The events of one category and name added together.
+struct TraceGroup {
+    const char* category;
+    String name;
+    u64 duration;
+    u32 count;
+};
+
+static bool trace_enabled;
+static u64 trace_base;
+
+static struct TraceBuffer* trace_buffers;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local struct TraceBuffer* thread_buffer;
+
+static u64 get_time() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (u64)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+void trace_enable() {
+    trace_enabled = true;
+    trace_base = get_time();
+}
+
+bool trace_is_enabled() {
+    return trace_enabled;
+}
+
+u64 trace_time() {
+    if (!trace_enabled) {
+        return 0;
+    }
+
+    return get_time();
+}
+
+static struct TraceBuffer* get_thread_buffer() {
+    if (thread_buffer == 0) {
+        thread_buffer = calloc(1, sizeof(struct TraceBuffer));
+        if (thread_buffer == 0) {
+            printf("Trace : calloc failed\n");
+            exit(1);
+        }
+
+        pthread_mutex_lock(&trace_lock);
+        thread_buffer->next = trace_buffers;
+        trace_buffers = thread_buffer;
+        pthread_mutex_unlock(&trace_lock);
+    }
+
+    return thread_buffer;
+}
+
+void trace_event(const char* category, String name, u64 start) {
+    if (!trace_enabled) {
+        return;
+    }
+
+    u64 end = get_time();
+    struct TraceBuffer* buffer = get_thread_buffer();
+
+    if (buffer->count == buffer->capacity) {
+        buffer->capacity = (buffer->capacity) ? buffer->capacity * 2 : 256;
+        buffer->events = realloc(buffer->events, buffer->capacity * sizeof(struct TraceEvent));
+
+        if (buffer->events == 0) {
+            printf("Trace : realloc failed\n");
+            exit(1);
+        }
+    }
+
+    buffer->events[buffer->count++] = (struct TraceEvent) {
+        .category = category,
+        .name     = name,
+        .start    = start - trace_base,
+        .duration = end - start,
+        .thread   = get_thread_index()
+    };
+}
+
+// Copies the events of all threads into one array. This must not be called while a parallel loop
+// is running.
+static struct TraceEvent* collect_events(u32* count) {
+    *count = 0;
+    for (struct TraceBuffer* buffer = trace_buffers; buffer; buffer = buffer->next) {
+        *count += buffer->count;
+    }
+
+    struct TraceEvent* events = malloc((*count + 1) * sizeof(struct TraceEvent));
+    u32 index = 0;
+
+    for (struct TraceBuffer* buffer = trace_buffers; buffer; buffer = buffer->next) {
+        __builtin_memcpy(&events[index], buffer->events, buffer->count * sizeof(struct TraceEvent));
+        index += buffer->count;
+    }
+
+    return events;
+}
+
+static s32 compare_names(String a, String b) {
+    u32 size = (a.size < b.size) ? a.size : b.size;
+    s32 result = __builtin_memcmp(a.text, b.text, size);
+
+    if (result) {
+        return result;
+    }
+
+    return (s32)a.size - (s32)b.size;
+}
+
+static int compare_by_start(const void* a, const void* b) {
+    const struct TraceEvent* x = a;
+    const struct TraceEvent* y = b;
+
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static int compare_by_name(const void* a, const void* b) {
+    const struct TraceEvent* x = a;
+    const struct TraceEvent* y = b;
+
+    s32 result = __builtin_strcmp(x->category, y->category);
+    if (result) {
+        return result;
+    }
+
+    return compare_names(x->name, y->name);
+}
+
+static int compare_by_duration(const void* a, const void* b) {
+    const struct TraceGroup* x = a;
+    const struct TraceGroup* y = b;
+
+    s32 result = __builtin_strcmp(x->category, y->category);
+    if (result) {
+        return result;
+    }
+
+    return (x->duration < y->duration) - (x->duration > y->duration);
+}
+
+static bool is_phase(struct TraceEvent* event) {
+    return __builtin_strcmp(event->category, "phase") == 0;
+}
+
+static double to_milliseconds(u64 nanoseconds) {
+    return nanoseconds / 1000000.0;
+}
+
+void trace_print_summary() {
+    u32 count;
+    struct TraceEvent* events = collect_events(&count);
+
+    // The phases run one after another, so they are listed in the order they ran.
+    qsort(events, count, sizeof(struct TraceEvent), compare_by_start);
+
+    u64 total = 0;
+    for (u32 i = 0; i < count; i++) {
+        if (is_phase(&events[i])) {
+            total += events[i].duration;
+        }
+    }
+
+    printf("\n%-24s %12s %8s\n", "Phase", "Time (ms)", "Share");
+
+    for (u32 i = 0; i < count; i++) {
+        if (is_phase(&events[i])) {
+            struct TraceEvent* event = &events[i];
+            double share = (total) ? 100.0 * event->duration / total : 0;
+
+            printf("%-24.*s %12.3f %7.1f%%\n", event->name.size, event->name.text, to_milliseconds(event->duration), share);
+        }
+    }
+
+    printf("%-24s %12.3f\n", "Total", to_milliseconds(total));
+
+    // The work items are added together by name. An item may be timed more than once e.g. when
+    // the typer has to wait for a declaration.
+    qsort(events, count, sizeof(struct TraceEvent), compare_by_name);
+
+    struct TraceGroup* groups = malloc((count + 1) * sizeof(struct TraceGroup));
+    u32 group_count = 0;
+
+    for (u32 i = 0; i < count; i++) {
+        if (is_phase(&events[i])) {
+            continue;
+        }
+
+        struct TraceGroup* last = (group_count) ? &groups[group_count - 1] : 0;
+
+        if (last == 0 || __builtin_strcmp(last->category, events[i].category) || compare_names(last->name, events[i].name)) {
+            last = &groups[group_count++];
+            *last = (struct TraceGroup){ .category = events[i].category, .name = events[i].name };
+        }
+
+        last->duration += events[i].duration;
+        last->count++;
+    }
+
+    qsort(groups, group_count, sizeof(struct TraceGroup), compare_by_duration);
+
+    for (u32 i = 0; i < group_count;) {
+        const char* category = groups[i].category;
+
+        u32 end = i;
+        u64 category_total = 0;
+
+        while (end < group_count && __builtin_strcmp(groups[end].category, category) == 0) {
+            category_total += groups[end++].duration;
+        }
+
+        printf("\nSlowest in %s (%u items, %.3f ms on all threads)\n", category, end - i, to_milliseconds(category_total));
+
+        for (u32 j = i; j < end && j < i + TRACE_SUMMARY_COUNT; j++) {
+            struct TraceGroup* group = &groups[j];
+            printf("  %-40.*s %12.3f ms %6u\n", group->name.size, group->name.text, to_milliseconds(group->duration), group->count);
+        }
+
+        i = end;
+    }
+
+    printf("\n");
+
+    free(groups);
+    free(events);
+}
+
+// Names come from file names and identifiers, so only quotes, backslashes and control characters
+// need escaping.
+static void write_json_string(FILE* file, String string) {
+    fputc('"', file);
+
+    for (u32 i = 0; i < string.size; i++) {
+        char c = string.text[i];
+
+        if (c == '"' || c == '\\') {
+            fprintf(file, "\\%c", c);
+        }
+        else if ((u8)c < 0x20) {
+            fprintf(file, "\\u%04x", (u8)c);
+        }
+        else {
+            fputc(c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+void trace_write(const char* file_name) {
+    FILE* file = fopen(file_name, "w");
+    if (file == 0) {
+        printf("Trace : could not open %s\n", file_name);
+        exit(1);
+    }
+
+    u32 count;
+    struct TraceEvent* events = collect_events(&count);
+    qsort(events, count, sizeof(struct TraceEvent), compare_by_start);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    for (u32 i = 0; i < count; i++) {
+        struct TraceEvent* event = &events[i];
+
+        // Complete events take the start and the duration in microseconds.
+        fprintf(file, "{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"cat\":\"%s\",\"name\":", event->thread, event->category);
+        write_json_string(file, event->name);
+        fprintf(file, ",\"ts\":%.3f,\"dur\":%.3f}%s\n", event->start / 1000.0, event->duration / 1000.0, (i + 1 < count) ? "," : "");
+    }
+
+    fprintf(file, "]}\n");
+    fclose(file);
+    free(events);
+}
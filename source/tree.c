@@ -1,9 +1,10 @@
 #include <tree.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <arena.h>
 
 Scope* new_scope() {
-    Scope* scope = calloc(1, sizeof(Scope));
+    Scope* scope = phase_allocate(ALLOCATION_SCOPE, sizeof(Scope));
 
     list_init(&scope->functions);
     list_init(&scope->variables);
@@ -14,36 +15,36 @@ Scope* new_scope() {
 }
 
 Declaration* new_declaration() {
-    Declaration* declaration = calloc(1, sizeof(Declaration));
+    Declaration* declaration = phase_allocate(ALLOCATION_DECLARATION, sizeof(Declaration));
     return declaration;
 }
 
 Program* new_program() {
-    Program* program = calloc(1, sizeof(Program));
+    Program* program = phase_allocate(ALLOCATION_OTHER, sizeof(Program));
 
     list_init(&program->code_units);
+    program->global_scope = new_scope();
     return program;
 }
 
 CodeUnit* new_code_unit() {
-    CodeUnit* unit = calloc(1, sizeof(CodeUnit));
+    CodeUnit* unit = phase_allocate(ALLOCATION_OTHER, sizeof(CodeUnit));
     return unit;
 }
 
 void* new_statement(StatementKind kind) {
-    Statement* statement = calloc(1, sizeof(Statement));
+    Statement* statement = phase_allocate(ALLOCATION_STATEMENT, sizeof(Statement));
     statement->kind = kind;
     return statement;
 }
 
 void* new_compound_statement() {
     Compound* compound = new_statement(STATEMENT_COMPOUND);
-    list_init(&compound->statements);
     return compound;
 }
 
 void* new_expression(ExpressionKind kind) {
-    Expression* expression = calloc(1, sizeof(Expression));
+    Expression* expression = phase_allocate(ALLOCATION_EXPRESSION, sizeof(Expression));
     expression->kind = kind;
     return expression;
 }
@@ -61,7 +62,7 @@ void* new_primary(PrimaryKind kind) {
 }
 
 void* new_type(TypeKind kind) {
-    Type* type = calloc(1, sizeof(Type));
+    Type* type = phase_allocate(ALLOCATION_TYPE, sizeof(Type));
     type->kind = kind;
     return type;
 }
@@ -77,7 +78,6 @@ void* new_pointer() {
 
 Call* new_call() {
     Call* call = new_expression(EXPRESSION_CALL);
-    list_init(&call->arguments);
     return call;
 }
 
@@ -94,16 +94,35 @@ StructType* new_struct() {
 }
 
 StructMember* new_struct_member() {
-    StructMember* member = calloc(1, sizeof(StructMember));
+    StructMember* member = phase_allocate(ALLOCATION_STRUCT_MEMBER, sizeof(StructMember));
     return member;
 }
 
 StructScope* new_struct_scope() {
-    StructScope* scope = calloc(1, sizeof(StructScope));
+    StructScope* scope = phase_allocate(ALLOCATION_STRUCT_SCOPE, sizeof(StructScope));
     list_init(&scope->members);
     return scope;
 }
 
+List* get_declaration_list(Scope* scope, DeclarationKind kind) {
+    switch (kind) {
+        case DECLARATION_VARIABLE : return &scope->variables;
+        case DECLARATION_FUNCTION : return &scope->functions;
+        case DECLARATION_TYPE     : return &scope->types;
+    }
+
+    return 0;
+}
+
+SymbolTable* get_declaration_index(Scope* scope, DeclarationKind kind) {
+    switch (kind) {
+        case DECLARATION_VARIABLE : return &scope->variable_index;
+        case DECLARATION_FUNCTION : return &scope->function_index;
+        case DECLARATION_TYPE     : return &scope->type_index;
+    }
+
+    return 0;
+}
 
 bool is_deref(Expression* expression) {
     return expression->kind == EXPRESSION_UNARY && expression->unary.kind == UNARY_DEREF;
@@ -115,9 +134,6 @@ bool is_variable(Expression* expression) {
 
 bool is_inferred(Expression* expression) {
     if (expression->kind == EXPRESSION_PRIMARY && expression->primary.kind == PRIMARY_IDENTIFIER) {
-        String name = expression->primary.name;
-        //printf("Checking if %.*s is inferred\n", name.size, name.text);
-
 
         assert(expression->primary.declaration);
         assert(expression->primary.declaration->type);
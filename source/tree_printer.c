@@ -102,8 +102,9 @@ static void print_expression(Expression* expression) {
         }
         case EXPRESSION_DOT : {
             Dot* dot = &expression->dot;
+            String member = get_token_name(dot->member);
 
-            indented_print("Dot: %.*s\n", dot->member->name.size, dot->member->name.text);
+            indented_print("Dot: %.*s\n", member.size, member.text);
             indentation++;
             print_expression(dot->expression);
             indentation--;
@@ -120,21 +121,18 @@ static void print_expression(Expression* expression) {
             print_expression(call->expression);
             indentation--;
 
-            if (list_is_empty(&call->arguments)) {
+            if (call->argument_count == 0) {
                 indented_print("Arguments: none\n");
             }
             else {
-                ListNode* it;
-                list_iterate(it, &call->arguments) {
-                    Expression* expr = list_to_struct(it, Expression, list_node);
-
-                    if (it->next == &call->arguments) {
+                for (u32 i = 0; i < call->argument_count; i++) {
+                    if (i == call->argument_count - 1) {
                         mask[call_indent] = false;
                     }
 
                     indented_print("Argument: \n");
                     indentation++;
-                    print_expression(expr);
+                    print_expression(call->arguments[i]);
                     indentation--;
                 }
             }
@@ -163,7 +161,7 @@ static void print_expression(Expression* expression) {
                 indented_print("Number : %d\n", primary->number);
             }
             else if (primary->kind == PRIMARY_IDENTIFIER) {
-                String name = primary->name;
+                String name = get_token_name(primary->token);
                 indented_print("Identifier : %.*s\n", name.size, name.text);
 
                 if (primary->declaration) {
@@ -171,7 +169,8 @@ static void print_expression(Expression* expression) {
                 }
             }
             else if (primary->kind == PRIMARY_STRING) {
-                indented_print("String : %.*s\n", primary->name.size, primary->name.text);
+                String string = get_token_name(primary->token);
+                indented_print("String : %.*s\n", string.size, string.text);
             }
             else {
                 printf("Primary not handled\n");
@@ -219,10 +218,13 @@ static void print_function(Declaration* decl) {
     indentation--;
     mask[function_indent] = false;
 
+    // Functions read from a cached interface have no body.
     if (function->assembly_function) {
-        print_asm_body(&function->assembly_body);
+        if (function->assembly_body.size) {
+            print_asm_body(&function->assembly_body);
+        }
     }
-    else {
+    else if (function->body) {
         print_statement(function->body);
     }
     
@@ -268,7 +270,7 @@ static void print_struct(Type* type, bool print_all) {
 static void print_type(Type* type, bool print_all) {
     switch (type->kind) {
         case TYPE_UNKNOWN : {
-            String name = type->unknown.token->name;
+            String name = get_token_name(type->unknown.token);
             colored_indented_print(KGRN,"Unknown : %.*s\n", name.size, name.text);
             break;
         }
@@ -369,15 +371,12 @@ static void print_statement(Statement* statement) {
             u32 compound_ident = indentation++;
             mask[compound_ident] = true;
 
-            ListNode* it;
-            list_iterate(it, &compound->statements) {
-                Statement* new = list_to_struct(it, Statement, list_node);
-
-                if (it->next == &compound->statements && scope_is_clear(compound->scope)) {
+            for (u32 i = 0; i < compound->statement_count; i++) {
+                if (i == compound->statement_count - 1 && scope_is_clear(compound->scope)) {
                     mask[compound_ident] = false;
                 }
 
-                print_statement(new);
+                print_statement(compound->statements[i]);
             }
 
             print_scope(compound->scope);
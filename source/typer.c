@@ -7,10 +7,11 @@
 #include <stdlib.h>
 #include <list.h>
 #include <string.h>
+#include <arena.h>
+#include <trace.h>
+#include <lexer.h>
+#include <output.h>
 
-static void type_scope(Scope* scope, Typer* typer);
-static void type_code_unit(CodeUnit* code_unit, Typer* typer);
-static void type_function(Declaration* decl, Typer* typer);
 static void type_statement(Statement* statement, Typer* typer);
 static void type_expression(Expression* expression, Typer* typer);
 static void type_binary_expression(Expression* expression, Typer* typer);
@@ -48,37 +49,98 @@ static void exit_scope(Typer* typer) {
     typer->current_scope = typer->current_scope->parent;
 }
 
-static Declaration* lookup_in_scope(Scope* scope, String* name, DeclarationKind kind) {
-    List* list = 0;
-    
-    if (kind == DECLARATION_VARIABLE) {
-        list = &scope->variables;
+// Scopes nested at least this deep will cache declarations found in the parent scopes.
+#define LOOKUP_CACHE_DEPTH 4
+
+static Declaration* lookup_in_scope(Scope* scope, u32 symbol, DeclarationKind kind) {
+    Declaration* decl = table_lookup(get_declaration_index(scope, kind), symbol);
+    if (decl || scope->parent == 0) {
+        return decl;
     }
-    else if (kind == DECLARATION_FUNCTION) {
-        list = &scope->functions;
+
+    if (scope->depth < LOOKUP_CACHE_DEPTH) {
+        return lookup_in_scope(scope->parent, symbol, kind);
     }
-    else if (kind == DECLARATION_TYPE) {
-        list = &scope->types;
+
+    // All declarations are pushed by the parser, so the scope chain does not change while typing, 
+    // and the cached result stays valid. The cache is keyed on both the symbol and the kind.
+    u32 key = (symbol << 2) | kind;
+
+    decl = table_lookup(&scope->lookup_cache, key);
+    if (decl == 0) {
+        decl = lookup_in_scope(scope->parent, symbol, kind);
+
+        if (decl) {
+            table_insert(&scope->lookup_cache, key, decl);
+        }
     }
 
-    ListNode* it;
-    list_iterate(it, list) {
-        Declaration* decl = list_to_struct(it, Declaration, list_node);
+    return decl;
+}
+
+static Declaration* lookup_in_current_scope(Typer* typer, u32 symbol, DeclarationKind kind) {
+    return lookup_in_scope(typer->current_scope, symbol, kind);
+}
 
-        if (string_compare(name, &decl->name)) {
-            return decl;
+static void add_work(Typer* typer, TypeItem* item) {
+    item->next = 0;
+
+    if (typer->worklist_last) {
+        typer->worklist_last->next = item;
+    }
+    else {
+        typer->worklist_first = item;
+    }
+
+    typer->worklist_last = item;
+}
+
+static TypeItem* take_work(Typer* typer) {
+    TypeItem* item = typer->worklist_first;
+
+    if (item) {
+        typer->worklist_first = item->next;
+
+        if (typer->worklist_first == 0) {
+            typer->worklist_last = 0;
         }
     }
 
-    if (scope->parent) {
-        return lookup_in_scope(scope->parent, name, kind);
+    return item;
+}
+
+// Called when something needs the type of a declaration which is not resolved yet. The item being
+// typed is parked on the first declaration it gets blocked on.
+static void block_on_declaration(Typer* typer, Declaration* declaration) {
+    typer->unresolved_types = true;
+
+    if (typer->blocker == 0) {
+        typer->blocker = declaration;
+    }
+}
+
+// Function bodies typed on several threads log the inferred types to their own buffer, which is 
+// printed in program order once all bodies are typed. Otherwise the log is printed right away.
+static void log_inference(Typer* typer, Declaration* declaration) {
+    if (typer->log == 0) {
+        printf("Inferring : %.*s\n", declaration->name.size, declaration->name.text);
+        return;
     }
 
-    return 0;
+    output_add(typer->log, "Inferring : ", 12);
+    output_add(typer->log, declaration->name.text, declaration->name.size);
+    output_add(typer->log, "\n", 1);
 }
 
-static Declaration* lookup_in_current_scope(Typer* typer, String* name, DeclarationKind kind) {
-    return lookup_in_scope(typer->current_scope, name, kind);
+// Moves all the items waiting for the declaration back on the worklist.
+static void declaration_resolved(Typer* typer, Declaration* declaration) {
+    while (declaration->waiters) {
+        TypeItem* item = declaration->waiters;
+        declaration->waiters = item->next;
+
+        typer->waiting_count--;
+        add_work(typer, item);
+    }
 }
 
 static void type_binary_expression(Expression* expression, Typer* typer) {
@@ -91,8 +153,19 @@ static void type_binary_expression(Expression* expression, Typer* typer) {
     assert(binary->right);
 
     type_expression(binary->right, typer);
+
+    // An inferred declaration on the left hand side gets its type from this expression, so it must
+    // not be recorded as something this expression is waiting on.
+    bool unresolved = typer->unresolved_types;
+    Declaration* blocker = typer->blocker;
+
     type_expression(binary->left, typer);
 
+    if (is_inferred(binary->left)) {
+        typer->unresolved_types = unresolved;
+        typer->blocker = blocker;
+    }
+
     if (binary->right->type == 0) {
         typer->unresolved_types = true;
         return;
@@ -106,10 +179,13 @@ static void type_binary_expression(Expression* expression, Typer* typer) {
             return;
         }
 
-        binary->left->primary.declaration->type = binary->right->type;
+        Declaration* declaration = binary->left->primary.declaration;
+
+        declaration->type = binary->right->type;
         binary->left->type = binary->right->type;
-        String name = binary->left->primary.declaration->name;
-        printf("Inferring : %.*s\n", name.size, name.text);
+        log_inference(typer, declaration);
+
+        declaration_resolved(typer, declaration);
     }
     else if (binary->left->type == 0) {
         typer->unresolved_types = true;
@@ -201,7 +277,7 @@ static void type_primary_expression(Expression* expression, Typer* typer) {
 
     if (primary->kind == PRIMARY_IDENTIFIER) {
         if (primary->declaration == 0) {
-            Declaration* decl = lookup_in_current_scope(typer, &primary->name, DECLARATION_VARIABLE);
+            Declaration* decl = lookup_in_current_scope(typer, primary->symbol, DECLARATION_VARIABLE);
             if (decl == 0) {
                 error_token(primary->token, "variables is not declarred");
             }
@@ -212,21 +288,18 @@ static void type_primary_expression(Expression* expression, Typer* typer) {
 
         if (is_valid_type(primary->declaration->type)) {
             expression->type = primary->declaration->type;
-            typer->type_resolved = true;
         }
         else {
-            typer->unresolved_types = true;
+            block_on_declaration(typer, primary->declaration);
         }
     }
     else if (primary->kind == PRIMARY_NUMBER) {
         expression->type = type_u64;
-        typer->type_resolved = true;
     }
     else if (primary->kind == PRIMARY_STRING) {
         Type* type = new_pointer();
         type->pointer.pointer_to = type_char;
         expression->type = type;
-        typer->type_resolved = true;
     }
 }
 
@@ -237,26 +310,23 @@ static void type_call_expression(Expression* expression, Typer* typer) {
 
     Call* call = &expression->call;
 
-    ListNode* it;
-    list_iterate(it, &call->arguments) {
-        Expression* argument = list_to_struct(it, Expression, list_node);
-        type_expression(argument, typer);
+    for (u32 i = 0; i < call->argument_count; i++) {
+        type_expression(call->arguments[i], typer);
     }
 
     assert(call->expression->kind == EXPRESSION_PRIMARY);
     assert(call->expression->primary.kind == PRIMARY_IDENTIFIER);
 
-    String name = call->expression->primary.name;
-    Declaration* decl = lookup_in_current_scope(typer, &name, DECLARATION_FUNCTION);
+    u32 symbol = call->expression->primary.symbol;
+    Declaration* decl = lookup_in_current_scope(typer, symbol, DECLARATION_FUNCTION);
     if (!decl) {
         //error_token(call->expression->primary.token, "function not found");
     } else {
-        typer->type_resolved = true;
         expression->type = decl->function.return_type;
     }
 }
 
-static StructMember* lookup_member_in_struct(String* name, Type* type) {
+static StructMember* lookup_member_in_struct(u32 symbol, Type* type) {
     assert(type->kind == TYPE_STRUCT);
     assert(type->Struct.scope);
 
@@ -266,7 +336,7 @@ static StructMember* lookup_member_in_struct(String* name, Type* type) {
 
         assert(member->is_anonymous == false);
 
-        if (string_compare(&member->name, name)) {
+        if (member->symbol == symbol) {
             return member;
         }
     }
@@ -298,13 +368,12 @@ static void type_dot_expression(Expression* expression, Typer* typer) {
             type_unary_expression((Expression *)unary, typer);
         }
 
-        StructMember* member = lookup_member_in_struct(&dot->member->name, dot->expression->type);
+        StructMember* member = lookup_member_in_struct(get_token_symbol(dot->member), dot->expression->type);
 
         if (member == 0) {
             error_token(dot->member, "invalid struct member");
         }
 
-        typer->type_resolved = true;
         dot->offset = member->offset;
         expression->type = member->type;
     }
@@ -342,10 +411,8 @@ static void type_expression(Expression* expression, Typer* typer) {
 static void type_compound_statement(Statement* statement, Typer* typer) {
     Compound* compound = &statement->compound;
     enter_scope(typer, compound->scope);
-    ListNode* it;
-    list_iterate(it, &compound->statements) {
-        Statement* new = list_to_struct(it, Statement, list_node);
-        type_statement(new, typer);
+    for (u32 i = 0; i < compound->statement_count; i++) {
+        type_statement(compound->statements[i], typer);
     }
     exit_scope(typer);
 }
@@ -420,38 +487,30 @@ static void type_statement(Statement* statement, Typer* typer) {
     }
 }
 
-static void type_function(Declaration* decl, Typer* typer) {
-    Function* function = &decl->function;
+static bool is_complete_struct(Type* type);
 
-    type_scope(function->function_scope, typer);
-    enter_scope(typer, function->function_scope);
+// A type which is used by value needs the layout of a named structure, so it waits until the 
+// structure is complete. Behind a pointer the structure may still be incomplete, which is what
+// makes self-referencing structures possible.
+static Type* resolve_unknown_type(Type* type, Typer* typer, bool needs_layout) {
+    UnknownType* unknown = &type->unknown;
 
-    if (function->assembly_function == false) {
-        assert(function->body->compound.scope != function->function_scope);
-        type_scope(function->body->compound.scope, typer);
-        type_statement(function->body, typer);
+    u32 symbol = get_token_symbol(unknown->token);
+    Declaration* declaration = lookup_in_current_scope(typer, symbol, DECLARATION_TYPE);
+    if (declaration == 0) {
+        error_token(unknown->token, "type is not declared");
     }
 
-    exit_scope(typer);
-}
-
-static Type* resolve_unknown_type(Type* type, Typer* typer) {
-    UnknownType* unknown = &type->unknown;
+    assert(declaration->type);
 
-    String name = unknown->token->name;
-    Declaration* declaration = lookup_in_current_scope(typer, &name, DECLARATION_TYPE);
-    if (declaration) {
-        assert(declaration->type);
-
-        if (is_valid_type(declaration->type)) {
-            typer->type_resolved = true;
+    if (is_valid_type(declaration->type)) {
+        if (!needs_layout || declaration->type->kind != TYPE_STRUCT || is_complete_struct(declaration->type)) {
             return declaration->type;
         }
-        else {
-            typer->unresolved_types = true;
-            return type;
-        }
     }
+
+    block_on_declaration(typer, declaration);
+    return type;
 }
 
 static u32 align(u32 number, u32 alignment) {
@@ -463,6 +522,10 @@ static u32 align(u32 number, u32 alignment) {
     return number;
 }
 
+static bool is_complete_struct(Type* type) {
+    return type->kind == TYPE_STRUCT && type->Struct.scope && type->Struct.scope->typing_complete;
+}
+
 static void compute_struct_offsets(Type* type) {
     assert(type->kind == TYPE_STRUCT);
     StructType* Struct = &type->Struct;
@@ -476,8 +539,9 @@ static void compute_struct_offsets(Type* type) {
         StructMember* member = list_to_struct(it, StructMember, list_node);
         Type* member_type = member->type;
 
-        if (member->type->kind == TYPE_STRUCT) {
-            // This will compute the size and alignment of the sub-structure.
+        // This will compute the size and alignment of the sub-structure. A declared structure
+        // which is complete already has its layout, and may be in use by other threads.
+        if (member->type->kind == TYPE_STRUCT && !is_complete_struct(member->type)) {
             compute_struct_offsets(member->type);
         }
 
@@ -557,14 +621,21 @@ static Type* resolve_struct_type(Type* type, Typer* typer) {
 static Type* resolve_type(Type* type, Typer* typer) {
     switch (type->kind) {
         case TYPE_POINTER : {
-            type->pointer.pointer_to = resolve_type(type->pointer.pointer_to, typer);
+            Type* pointer_to = type->pointer.pointer_to;
+
+            if (pointer_to->kind == TYPE_UNKNOWN) {
+                type->pointer.pointer_to = resolve_unknown_type(pointer_to, typer, false);
+            }
+            else {
+                type->pointer.pointer_to = resolve_type(pointer_to, typer);
+            }
             break;
         }
         case TYPE_INFERRED : {
             break;
         }
         case TYPE_UNKNOWN : {
-            return resolve_unknown_type(type, typer);
+            return resolve_unknown_type(type, typer, true);
             break;
         }
         case TYPE_STRUCT : {
@@ -583,43 +654,44 @@ static Type* resolve_type(Type* type, Typer* typer) {
     return type;
 }
 
-static void resolve_declraration_type(Declaration* declaration, Typer* typer) {
-    // We are using one global variable to determine if there are any unresolved types still.
-    // We save that variable (restore it after), to check if the entire structure is still
-    // untyped.
-    bool saved_unresolved = typer->unresolved_types;
-    typer->unresolved_types = false;
-
-    if (declaration->type->kind != TYPE_STRUCT || declaration->type->Struct.scope->typing_complete == false) {
+// Returns true if the declaration no longer depends on anything. The layout of a structure is only
+// computed by the item which completes it, since a local declaration of a global structure type may
+// be resolved while other function bodies read the member offsets.
+static bool resolve_declraration_type(Declaration* declaration, Typer* typer) {
+    if (!is_complete_struct(declaration->type)) {
         declaration->type = resolve_type(declaration->type, typer);
 
-        if (declaration->type->kind == TYPE_STRUCT) {
-            declaration->type->Struct.scope->typing_complete = !typer->unresolved_types;
-
-            if (declaration->type->Struct.scope->typing_complete) {
-                compute_struct_offsets(declaration->type);
-                fix_struct_offsets(declaration->type, 0);
-            }
+        if (declaration->type->kind == TYPE_STRUCT && !is_complete_struct(declaration->type) && !typer->unresolved_types) {
+            declaration->type->Struct.scope->typing_complete = true;
+            compute_struct_offsets(declaration->type);
+            fix_struct_offsets(declaration->type, 0);
         }
     }
 
-    typer->unresolved_types = typer->unresolved_types || saved_unresolved;
+    return !typer->unresolved_types;
 }
 
-static void type_scope(Scope* scope, Typer* typer) {
-    enter_scope(typer, scope);
+static TypeItem* new_type_item(Scope* scope) {
+    TypeItem* item = phase_allocate(ALLOCATION_TYPE_ITEM, sizeof(TypeItem));
+    item->scope = scope;
+    return item;
+}
 
-    ListNode* it;
-    list_iterate(it, &scope->types) {
-        Declaration* declaration = list_to_struct(it, Declaration, list_node);
-        resolve_declraration_type(declaration, typer);        
-    }
+// Puts the type and variable declarations of the scope on the worklist, and gives the functions 
+// without a return type a void one.
+static void seed_declarations(Scope* scope, Typer* typer) {
+    List* lists[] = { &scope->types, &scope->variables };
 
-    list_iterate(it, &scope->variables) {        
-        Declaration* declaration = list_to_struct(it, Declaration, list_node);
-        resolve_declraration_type(declaration, typer);
+    for (u32 i = 0; i < 2; i++) {
+        ListNode* it;
+        list_iterate(it, lists[i]) {
+            TypeItem* item = new_type_item(scope);
+            item->declaration = list_to_struct(it, Declaration, list_node);
+            add_work(typer, item);
+        }
     }
 
+    ListNode* it;
     list_iterate(it, &scope->functions) {
         Declaration* decl = list_to_struct(it, Declaration, list_node);
         assert(decl->kind == DECLARATION_FUNCTION);
@@ -627,33 +699,278 @@ static void type_scope(Scope* scope, Typer* typer) {
         if (decl->function.return_type == 0) {
             decl->function.return_type = new_type(TYPE_VOID);
         }
+    }
+}
+
+// Puts every declaration below the scope on the worklist. The declarations go before the 
+// statements, as the statements mostly depend on them.
+static void seed_scope(Scope* scope, Typer* typer) {
+    seed_declarations(scope, typer);
 
-        type_function(decl, typer);
+    ListNode* it;
+    list_iterate(it, &scope->child_scopes) {
+        seed_scope(list_to_struct(it, Scope, list_node), typer);
     }
+}
 
-    exit_scope(typer);
+static void seed_function_statements(Declaration* decl, Typer* typer) {
+    Function* function = &decl->function;
+
+    // Functions read from a cached interface have no body, and are only typed for their 
+    // signature.
+    if (function->assembly_function || function->body == 0) {
+        return;
+    }
+
+    assert(function->body->kind == STATEMENT_COMPOUND);
+    Compound* body = &function->body->compound;
+
+    for (u32 i = 0; i < body->statement_count; i++) {
+        TypeItem* item = new_type_item(body->scope);
+        item->statement = body->statements[i];
+        item->function  = decl;
+        add_work(typer, item);
+    }
 }
 
-static void type_code_unit(CodeUnit* code_unit, Typer* typer) {
-    type_scope(code_unit->global_scope, typer);
+// Puts the top-level statements of every function below the scope on the worklist.
+static void seed_statements(Scope* scope, Typer* typer) {
+    ListNode* it;
+    list_iterate(it, &scope->functions) {
+        seed_function_statements(list_to_struct(it, Declaration, list_node), typer);
+    }
+
+    list_iterate(it, &scope->child_scopes) {
+        seed_statements(list_to_struct(it, Scope, list_node), typer);
+    }
 }
 
-void type_program(Program* program, Typer* typer) {
-    typer->current_scope = 0;
+// Seeds the local declarations and the statements of a global function, including the functions 
+// nested inside it.
+static void seed_function(Declaration* decl, Typer* typer) {
+    Scope* scope = decl->function.body->compound.scope;
+
+    seed_scope(scope, typer);
+    seed_function_statements(decl, typer);
+    seed_statements(scope, typer);
+}
+
+static void type_item(TypeItem* item, Typer* typer) {
+    typer->current_scope    = item->scope;
+    typer->unresolved_types = false;
+    typer->blocker          = 0;
+
+    u64 start = trace_time();
+
+    if (item->declaration) {
+        if (resolve_declraration_type(item->declaration, typer) && is_valid_type(item->declaration->type)) {
+            declaration_resolved(typer, item->declaration);
+        }
+
+        trace_event("resolve", item->declaration->name, start);
+    }
+    else {
+        type_statement(item->statement, typer);
+        trace_event("type", item->function->name, start);
+    }
+
+    if (typer->unresolved_types == false) {
+        return;
+    }
+
+    if (typer->blocker) {
+        // Typing the item again is only useful once the declaration it is waiting on changes.
+        item->next = typer->blocker->waiters;
+        typer->blocker->waiters = item;
+        typer->waiting_count++;
+    }
+    else {
+        // This is missing something which no declaration will provide e.g. an unknown function.
+        typer->stuck_count++;
+    }
+}
+
+// Every item is typed once, and then once more for each declaration it gets blocked on, instead 
+// of re-typing the entire program until nothing changes.
+static void run_worklist(Typer* typer) {
+    TypeItem* item;
+    while ((item = take_work(typer))) {
+        type_item(item, typer);
+    }
+}
+
+// The typing of one global function body. The counts are those left on its own worklist.
+struct BodyTyping {
+    Declaration* function;
+    OutputBuffer log;
+    u32 waiting_count;
+    u32 stuck_count;
+
+    // Set for the bodies which mention an inferred global.
+    bool is_serial;
+};
+
+struct BodyTypings {
+    struct BodyTyping* bodies;
+    u32 count;
+    bool is_parallel;
+};
+
+static void type_function_body(void* context, u32 index) {
+    struct BodyTypings* typings = context;
+    struct BodyTyping* body = &typings->bodies[index];
+    if (body->is_serial) {
+        return;
+    }
+
+    Typer typer = { .log = (typings->is_parallel) ? &body->log : 0 };
+    seed_function(body->function, &typer);
+    run_worklist(&typer);
+
+    body->waiting_count = typer.waiting_count;
+    body->stuck_count   = typer.stuck_count;
+}
+
+// A global variable declared without a type gets its type from an assignment in some function 
+// body, and every body using it may have to wait for that. The bodies which mention such a global
+// are found on their tokens, like the reachability pass does, and are typed together on one 
+// worklist. A local which shadows such a global just makes its body serial for no reason.
+static void find_serial_bodies(struct BodyTypings* typings, Program* program) {
+    SymbolTable inferred = { 0 };
 
     ListNode* it;
     list_iterate(it, &program->code_units) {
         CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
 
-        while (typer->unresolved_types && typer->type_resolved) {
-            typer->type_resolved = false;
-            typer->unresolved_types = false;
-            type_code_unit(code_unit, typer);
+        ListNode* variable_it;
+        list_iterate(variable_it, &code_unit->global_scope->variables) {
+            Declaration* declaration = list_to_struct(variable_it, Declaration, list_node);
+
+            if (declaration->type->kind == TYPE_INFERRED) {
+                table_insert(&inferred, declaration->symbol, declaration);
+            }
         }
+    }
 
-        if (typer->unresolved_types) {
-            printf("Typer failed\n");
-            exit(1);
+    if (inferred.count == 0) {
+        return;
+    }
+
+    for (u32 i = 0; i < typings->count; i++) {
+        Function* function = &typings->bodies[i].function->function;
+
+        for (u32 token = function->body_start; token < function->body_end; token++) {
+            if (get_token_kind(token) == TOKEN_IDENTIFIER && table_lookup(&inferred, get_token_symbol(token))) {
+                typings->bodies[i].is_serial = true;
+                break;
+            }
+        }
+    }
+}
+
+// The typing is done in two stages. First the global declarations and the function signatures are
+// resolved on one thread. After that, nothing a function body can resolve is visible to another 
+// body, except for the inferred globals, so every body is typed on its own worklist on the thread 
+// pool. The bodies using inferred globals share one worklist, which is typed on this thread.
+void type_program(Program* program, ThreadPool* pool) {
+    Typer typer = { 0 };
+    struct BodyTypings typings = { 0 };
+
+    ListNode* it;
+    list_iterate(it, &program->code_units) {
+        CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
+        Scope* scope = code_unit->global_scope;
+
+        seed_declarations(scope, &typer);
+
+        ListNode* scope_it;
+        list_iterate(scope_it, &scope->child_scopes) {
+            seed_declarations(list_to_struct(scope_it, Scope, list_node), &typer);
+        }
+
+        ListNode* function_it;
+        list_iterate(function_it, &scope->functions) {
+            Declaration* declaration = list_to_struct(function_it, Declaration, list_node);
+            Function* function = &declaration->function;
+
+            if (!function->assembly_function && function->body) {
+                typings.count++;
+            }
+        }
+    }
+
+    run_worklist(&typer);
+
+    // A global declaration which is still waiting can not be resolved by any function body, and 
+    // the bodies must not park items on the global declarations from several threads.
+    if (typer.waiting_count || typer.stuck_count) {
+        printf("Typer failed\n");
+        exit(1);
+    }
+
+    typings.bodies = calloc(typings.count, sizeof(struct BodyTyping));
+    u32 index = 0;
+
+    list_iterate(it, &program->code_units) {
+        CodeUnit* code_unit = list_to_struct(it, CodeUnit, list_node);
+
+        ListNode* function_it;
+        list_iterate(function_it, &code_unit->global_scope->functions) {
+            Declaration* declaration = list_to_struct(function_it, Declaration, list_node);
+            Function* function = &declaration->function;
+
+            if (!function->assembly_function && function->body) {
+                output_init(&typings.bodies[index].log);
+                typings.bodies[index++].function = declaration;
+            }
         }
     }
+
+    find_serial_bodies(&typings, program);
+
+    // The serial bodies share the worklist of the first stage, and are typed before the others.
+    for (u32 i = 0; i < typings.count; i++) {
+        struct BodyTyping* body = &typings.bodies[i];
+
+        if (body->is_serial) {
+            seed_scope(body->function->function.body->compound.scope, &typer);
+        }
+    }
+
+    for (u32 i = 0; i < typings.count; i++) {
+        struct BodyTyping* body = &typings.bodies[i];
+
+        if (body->is_serial) {
+            seed_function_statements(body->function, &typer);
+            seed_statements(body->function->function.body->compound.scope, &typer);
+        }
+    }
+
+    run_worklist(&typer);
+
+    typings.is_parallel = pool->thread_count > 1 && typings.count > 1;
+    thread_pool_run(pool, type_function_body, &typings, typings.count);
+
+    u32 waiting_count = typer.waiting_count;
+    u32 stuck_count   = typer.stuck_count;
+
+    for (u32 i = 0; i < typings.count; i++) {
+        struct BodyTyping* body = &typings.bodies[i];
+        waiting_count += body->waiting_count;
+        stuck_count   += body->stuck_count;
+
+        OutputBlock* block;
+        for (block = body->log.first; block; block = block->next) {
+            printf("%.*s", block->size, block->data);
+        }
+
+        output_release(&body->log);
+    }
+
+    free(typings.bodies);
+
+    if (waiting_count || stuck_count) {
+        printf("Typer failed\n");
+        exit(1);
+    }
 }